@@ -102,4 +102,116 @@
 /* 32 bit, 3 values, pressure, tap anywhere(0,1,2), tap hold timeout */
 #define SYNAPTICS_PROP_TAP_EXTRAS "Synaptics Tap Extras"
 
+/* 32 bit, 1 value, milliseconds after a key press on the TypingKeyboard
+ * during which taps and motion are suppressed, 0 disables */
+#define SYNAPTICS_PROP_TYPING_TIMEOUT "Synaptics Typing Timeout"
+
+/* 32 bit, SYNAPTICS_PB_COUNT values, all tunables above in one property.
+ * A write replaces the whole configuration at once and is either applied
+ * completely or rejected. Value 0 is the layout version and must be
+ * SYNAPTICS_PB_VERSION. FLOAT values are stored as their IEEE 754 bit
+ * pattern. SYNAPTICS_PB_OFF reports "Synaptics Off" but is ignored on
+ * write, switching the touchpad off isn't tuning. The per-setting
+ * properties that change are announced with DevicePropertyNotify. */
+#define SYNAPTICS_PROP_PARAM_BLOCK "Synaptics Parameter Block"
+
+#define SYNAPTICS_PB_VERSION                    2
+
+#define SYNAPTICS_PB_LAYOUT_VERSION             0
+#define SYNAPTICS_PB_FINGER_LOW                 1
+#define SYNAPTICS_PB_FINGER_HIGH                2
+#define SYNAPTICS_PB_TAP_TIME                   3
+#define SYNAPTICS_PB_TAP_MOVE                   4
+#define SYNAPTICS_PB_CLICKPAD                   5
+#define SYNAPTICS_PB_SCROLL_DIST_VERT           6
+#define SYNAPTICS_PB_SCROLL_DIST_HORIZ          7
+#define SYNAPTICS_PB_SCROLL_TWOFINGER_VERT      8
+#define SYNAPTICS_PB_SCROLL_TWOFINGER_HORIZ     9
+#define SYNAPTICS_PB_MIN_SPEED                  10      /* FLOAT */
+#define SYNAPTICS_PB_MAX_SPEED                  11      /* FLOAT */
+#define SYNAPTICS_PB_ACCEL_FACTOR               12      /* FLOAT */
+#define SYNAPTICS_PB_OFF                        13
+#define SYNAPTICS_PB_PRESSURE_MOTION_MIN_Z      14
+#define SYNAPTICS_PB_PRESSURE_MOTION_MAX_Z      15
+#define SYNAPTICS_PB_PRESSURE_MOTION_MIN_FACTOR 16      /* FLOAT */
+#define SYNAPTICS_PB_PRESSURE_MOTION_MAX_FACTOR 17      /* FLOAT */
+#define SYNAPTICS_PB_GRAB                       18
+#define SYNAPTICS_PB_HYST_X                     19
+#define SYNAPTICS_PB_HYST_Y                     20
+#define SYNAPTICS_PB_BOTTOM_BUTTONS_HEIGHT      21
+#define SYNAPTICS_PB_BOTTOM_BUTTONS_SEP_POS     22
+#define SYNAPTICS_PB_BOTTOM_BUTTONS_SEP_WIDTH   23
+#define SYNAPTICS_PB_TOP_BUTTONS_HEIGHT         24
+#define SYNAPTICS_PB_TOP_BUTTONS_MIDDLE_WIDTH   25
+#define SYNAPTICS_PB_TWOFINGER_FINGER_SIZE      26
+#define SYNAPTICS_PB_TAP_PRESSURE               27
+#define SYNAPTICS_PB_TAP_ANYWHERE               28
+#define SYNAPTICS_PB_TAP_HOLD                   29
+#define SYNAPTICS_PB_TYPING_TIMEOUT             30      /* since version 2 */
+#define SYNAPTICS_PB_COUNT                      31
+
+/* 32 bit, 1 value, index of the active parameter profile */
+#define SYNAPTICS_PROP_ACTIVE_PROFILE "Synaptics Active Profile"
+
+/* STRING, read-only, NUL-separated profile names in index order */
+#define SYNAPTICS_PROP_PROFILE_NAMES "Synaptics Profile Names"
+
+/* 32 bit, 2 values, update interval in ms (0 stops monitoring), lease in
+ * ms. Monitoring stops by itself once the lease runs out or the device is
+ * disabled, a monitor renews it by writing the property again. */
+#define SYNAPTICS_PROP_MONITOR_CONTROL "Synaptics Monitor Control"
+
+/* 32 bit, SYNAPTICS_MON_COUNT values (read-only), the post-filter touchpad
+ * state, updated at most once per interval while monitoring */
+#define SYNAPTICS_PROP_MONITOR_STATE "Synaptics Monitor State"
+
+#define SYNAPTICS_MON_TIME                      0
+#define SYNAPTICS_MON_BUTTONS                   1
+#define SYNAPTICS_MON_SCROLL                    2       /* two-finger scroll mode */
+#define SYNAPTICS_MON_TOUCHES                   3       /* active touches */
+#define SYNAPTICS_MON_TOUCH_BASE                4       /* per touch values follow */
+#define SYNAPTICS_MON_MAX_TOUCHES               2
+#define SYNAPTICS_MON_COUNT                     \
+    (SYNAPTICS_MON_TOUCH_BASE + SYNAPTICS_MON_MAX_TOUCHES * SYNAPTICS_MON_TOUCH_SIZE)
+
+/* per touch, relative to SYNAPTICS_MON_TOUCH_BASE + n * SYNAPTICS_MON_TOUCH_SIZE */
+#define SYNAPTICS_MON_TOUCH_X                   0
+#define SYNAPTICS_MON_TOUCH_Y                   1
+#define SYNAPTICS_MON_TOUCH_Z                   2
+#define SYNAPTICS_MON_TOUCH_AREA                3       /* -2 lifted, -1 button gap,
+                                                           0 move area, 1/2/4 button */
+#define SYNAPTICS_MON_TOUCH_TAP                 4       /* tap state, 0 none,
+                                                           1 wait, 2 hold wait, 3 hold */
+#define SYNAPTICS_MON_TOUCH_SIZE                5
+
+/* 32 bit, SYNAPTICS_LAT_COUNT values (read-only), frames counted by the
+ * time from the kernel timestamp of their SYN_REPORT to the driver posting
+ * the first event for them. Bucket 0 holds frames posted within the same
+ * ms, bucket n those 2^(n-1) to 2^n - 1 ms late, the last one anything
+ * later. Frames that post nothing or end with SYN_DROPPED aren't counted. Any write resets all
+ * buckets to 0 instead of setting them. */
+#define SYNAPTICS_PROP_LATENCY "Synaptics Latency Histogram"
+
+#define SYNAPTICS_LAT_COUNT                     12
+
+/* 32 bit, SYNAPTICS_CNT_COUNT values (read-only), counts of what the input
+ * path did since the device was added, wrapping at 2^32. Any write resets
+ * all counters to 0 instead of setting them. */
+#define SYNAPTICS_PROP_COUNTERS "Synaptics Counters"
+
+#define SYNAPTICS_CNT_EVENTS                    0       /* evdev events read */
+#define SYNAPTICS_CNT_FRAMES                    1       /* SYN_REPORT frames */
+#define SYNAPTICS_CNT_DROPPED                   2       /* SYN_DROPPED */
+#define SYNAPTICS_CNT_RESYNCS                   3       /* frames synced after a drop */
+#define SYNAPTICS_CNT_OFF_FRAMES                4       /* frames ignored, Synaptics Off 1 */
+#define SYNAPTICS_CNT_MOTION_POSTS              5
+#define SYNAPTICS_CNT_BUTTON_POSTS              6
+#define SYNAPTICS_CNT_SCROLL_POSTS              7
+#define SYNAPTICS_CNT_TIMER_ARMS                8
+#define SYNAPTICS_CNT_TIMER_CANCELS             9
+#define SYNAPTICS_CNT_TIMER_FIRES               10
+#define SYNAPTICS_CNT_JUMPS                     11      /* motion dropped, delta > 400 */
+#define SYNAPTICS_CNT_CLICK_TAPS                12      /* taps ignored right after a click */
+#define SYNAPTICS_CNT_COUNT                     13
+
 #endif                          /* _SYNAPTICS_PROPERTIES_H_ */
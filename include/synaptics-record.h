@@ -0,0 +1,95 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _SYNAPTICS_RECORD_H_
+#define _SYNAPTICS_RECORD_H_
+
+#include <stdint.h>
+
+/**
+ * Touchpad recording, as replayed by the driver's "replay" protocol.
+ *
+ * A recording is a struct SynapticsRecordHeader describing the device
+ * followed by struct SynapticsRecordEvent records, one per evdev event, in
+ * the order the kernel delivered them. Everything is in the byte order of
+ * the machine that wrote it, a swapped magic tells the reader it can't use
+ * the file. The records are fixed size and naturally aligned so the file
+ * can be mapped and used in place.
+ *
+ * Events don't carry a time of their own. A record of type
+ * SYNAPTICS_RECORD_TIME sets the time of the events after it: value is
+ * CLOCK_MONOTONIC in ms (the low 32 bits, as an unsigned number) and code
+ * the us within that ms. Writers add one where the time changes, the
+ * kernel stamps all events of a frame alike, so it takes one per frame at
+ * most. The first record is always one.
+ *
+ * Records start at header_size, which lets later versions append fields to
+ * the header. Readers must check magic and event_size and may accept any
+ * version >= the one they know. A truncated last record is ignored.
+ */
+
+#define SYNAPTICS_RECORD_MAGIC          0x524e5953      /* "SYNR" */
+#define SYNAPTICS_RECORD_VERSION        2
+
+#define SYNAPTICS_RECORD_TIME           0xffff  /* not an EV_* type */
+
+#define SYNAPTICS_RECORD_ABS_CNT        0x40    /* ABS_CNT */
+#define SYNAPTICS_RECORD_KEY_CNT        0x300   /* KEY_CNT */
+
+#define SYNAPTICS_RECORD_TEST_BIT(bits, n) \
+    (((bits)[(n) / 8] >> ((n) % 8)) & 1)
+
+struct SynapticsRecordAbs {
+    int32_t minimum;
+    int32_t maximum;
+    int32_t fuzz;
+    int32_t flat;
+    int32_t resolution;
+};
+
+struct SynapticsRecordHeader {
+    uint32_t magic;             /* SYNAPTICS_RECORD_MAGIC */
+    uint32_t version;           /* SYNAPTICS_RECORD_VERSION */
+    uint32_t header_size;       /* offset of the first event */
+    uint32_t event_size;        /* sizeof(struct SynapticsRecordEvent) */
+
+    uint16_t bustype;
+    uint16_t vendor;
+    uint16_t product;
+    uint16_t id_version;
+    char name[80];              /* device name, NUL terminated */
+
+    uint32_t props;             /* INPUT_PROP_* bits */
+    uint32_t num_slots;         /* touch slots, 0 if not multitouch */
+    uint8_t abs_bits[SYNAPTICS_RECORD_ABS_CNT / 8];
+    uint8_t key_bits[SYNAPTICS_RECORD_KEY_CNT / 8];
+    struct SynapticsRecordAbs abs[SYNAPTICS_RECORD_ABS_CNT];
+};
+
+struct SynapticsRecordEvent {
+    uint16_t type;              /* EV_* or SYNAPTICS_RECORD_TIME */
+    uint16_t code;
+    int32_t value;
+};
+
+#endif                          /* _SYNAPTICS_RECORD_H_ */
@@ -0,0 +1,76 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _SYNAPTICS_SHM_H_
+#define _SYNAPTICS_SHM_H_
+
+#include <stdint.h>
+
+/**
+ * Shared memory segment the driver publishes its state in when the
+ * "SharedMemory" option is on. The segment is named after the X input
+ * device id, see SYNAPTICS_SHM_NAME, and is readable by everyone.
+ *
+ * The driver updates it after every hardware frame without ever waiting
+ * for readers. Readers use the sequence counter:
+ *
+ *   do {
+ *       seq = shm->seq;                 (retry while odd)
+ *       read barrier, copy the fields, read barrier
+ *   } while (seq & 1 || shm->seq != seq);
+ *
+ * New fields are only ever added at the end, with a version bump. Readers
+ * must check magic and may accept any version >= the one they know.
+ */
+
+#define SYNAPTICS_SHM_NAME      "/synaptics-%d" /* X input device id */
+#define SYNAPTICS_SHM_MAGIC     0x53594e53      /* "SYNS" */
+#define SYNAPTICS_SHM_VERSION   1
+
+#define SYNAPTICS_SHM_MAX_TOUCHES 2
+
+struct SynapticsShmTouch {
+    int32_t x, y;               /* after jitter filtering */
+    int32_t z;
+    int32_t org_x, org_y;       /* where the tap started */
+    int32_t area;               /* -2 lifted, -1 button gap, 0 move area,
+                                   1/2/4 button the touch started in */
+    int32_t tap_state;          /* 0 none, 1 wait, 2 hold wait, 3 hold */
+    int32_t typing;             /* touch began while typing */
+};
+
+struct SynapticsShm {
+    uint32_t magic;             /* SYNAPTICS_SHM_MAGIC */
+    uint32_t version;           /* SYNAPTICS_SHM_VERSION */
+    uint32_t size;              /* sizeof(struct SynapticsShm) of the writer */
+    volatile uint32_t seq;      /* odd while the driver writes */
+
+    uint32_t frames;            /* hardware frames handled */
+    uint32_t time;              /* time of the last frame in ms */
+    int32_t buttons;            /* button mask posted */
+    int32_t scroll;             /* two-finger scroll mode */
+    int32_t touches;            /* active touches */
+    struct SynapticsShmTouch touch[SYNAPTICS_SHM_MAX_TOUCHES];
+};
+
+#endif                          /* _SYNAPTICS_SHM_H_ */
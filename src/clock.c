@@ -0,0 +1,84 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "clock.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+static CARD32
+sim_now(struct SynapticsClock *clock)
+{
+    struct SimClock *sim = (struct SimClock *) clock;
+
+    return sim->now;
+}
+
+static void
+sim_set_timer(struct SynapticsClock *clock, CARD32 millis,
+              ClockTimerFunc func, void *arg)
+{
+    struct SimClock *sim = (struct SimClock *) clock;
+
+    sim->armed = (millis != 0);
+    sim->expires = sim->now + millis;
+    sim->func = func;
+    sim->arg = arg;
+}
+
+void
+SimClockInit(struct SimClock *sim, CARD32 now)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->clock.now = sim_now;
+    sim->clock.set_timer = sim_set_timer;
+    sim->now = now;
+}
+
+/**
+ * Move the time forward to the given time. A timer expiring on the way
+ * fires with the clock reading its expiry time, so a timer it arms
+ * again is relative to that too and may fire within the same call.
+ * Time never moves back, an earlier time leaves the clock alone.
+ */
+void
+SimClockAdvance(struct SimClock *sim, CARD32 to)
+{
+    while (sim->armed && (INT32) (sim->expires - to) <= 0) {
+        if ((INT32) (sim->expires - sim->now) > 0)
+            sim->now = sim->expires;
+        sim->armed = FALSE;
+        sim->fires++;
+        sim->func(sim->arg);
+    }
+
+    if ((INT32) (to - sim->now) > 0)
+        sim->now = to;
+}
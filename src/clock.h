@@ -0,0 +1,63 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+/*
+ * Where the driver gets the time and the gesture engine's timer from. The
+ * X server clock in synaptics.c reads GetTimeInMillis() and arms an
+ * OsTimer. The simulated clock below only moves when told to: tools use
+ * it to run recordings faster than real time, with the timer firing at
+ * exactly the offset it was armed for. Doesn't depend on the X server.
+ */
+
+#include <X11/Xdefs.h>
+#include <X11/Xmd.h>
+
+typedef void (*ClockTimerFunc) (void *arg);
+
+struct SynapticsClock {
+    /* current time in ms, on the clock of the frame timestamps */
+    CARD32 (*now) (struct SynapticsClock *clock);
+    /* (re)arm the timer to call func(arg) in millis, 0 cancels it */
+    void (*set_timer) (struct SynapticsClock *clock, CARD32 millis,
+                       ClockTimerFunc func, void *arg);
+};
+
+struct SimClock {
+    struct SynapticsClock clock;
+
+    CARD32 now;
+    Bool armed;
+    CARD32 expires;
+    ClockTimerFunc func;
+    void *arg;
+
+    unsigned long fires;        /* timer expiries so far */
+};
+
+extern void SimClockInit(struct SimClock *sim, CARD32 now);
+extern void SimClockAdvance(struct SimClock *sim, CARD32 to);
+
+#endif                          /* _CLOCK_H_ */
@@ -53,6 +53,7 @@
 #include <time.h>
 #include "synproto.h"
 #include "synapticsstr.h"
+#include "evframe.h"
 #include <xf86.h>
 #include <libevdev/libevdev.h>
 
@@ -220,11 +221,7 @@ EventDeviceOffHook(InputInfoPtr pInfo)
 
 /**
  * Test if the device on the file descriptior is recognized as touchpad
- * device. Required bits for touchpad recognition are:
- * - ABS_X + ABS_Y for absolute axes
- * - ABS_PRESSURE or BTN_TOUCH
- * - BTN_TOOL_FINGER
- * - BTN_TOOL_PEN is _not_ set
+ * device, see EvdevIsTouchpad() for the required bits.
  *
  * @param evdev Libevdev handle
  * @param test_grab If true, test whether an EVIOCGRAB is possible on the
@@ -243,24 +240,7 @@ event_query_is_touchpad(struct libevdev *evdev, BOOL test_grab)
             return FALSE;
     }
 
-    /* Check for ABS_X, ABS_Y, ABS_PRESSURE and BTN_TOOL_FINGER */
-    if (!libevdev_has_event_type(evdev, EV_SYN) ||
-        !libevdev_has_event_type(evdev, EV_ABS) ||
-        !libevdev_has_event_type(evdev, EV_KEY))
-        goto unwind;
-
-    if (!libevdev_has_event_code(evdev, EV_ABS, ABS_X) ||
-        !libevdev_has_event_code(evdev, EV_ABS, ABS_Y))
-        goto unwind;
-
-    /* we expect touchpad either report raw pressure or touches */
-    if (!libevdev_has_event_code(evdev, EV_KEY, BTN_TOUCH) &&
-        !libevdev_has_event_code(evdev, EV_ABS, ABS_PRESSURE))
-        goto unwind;
-
-    /* all Synaptics-like touchpad report BTN_TOOL_FINGER */
-    if (!libevdev_has_event_code(evdev, EV_KEY, BTN_TOOL_FINGER) ||
-        libevdev_has_event_code(evdev, EV_ABS, BTN_TOOL_PEN)) /* Don't match wacom tablets */
+    if (!EvdevIsTouchpad(evdev))
         goto unwind;
 
     ret = TRUE;
@@ -375,10 +355,10 @@ event_query_axis_ranges(InputInfoPtr pInfo)
     /* The kernel's fuzziness concept seems a bit weird, but it can more or
      * less be applied as hysteresis directly, i.e. no factor here. */
     event_get_abs(proto_data->evdev, ABS_X, &priv->minx, &priv->maxx,
-                  &priv->synpara.hyst_x, &priv->resx);
+                  &priv->synpara->hyst_x, &priv->resx);
 
     event_get_abs(proto_data->evdev, ABS_Y, &priv->miny, &priv->maxy,
-                  &priv->synpara.hyst_y, &priv->resy);
+                  &priv->synpara->hyst_y, &priv->resy);
 
     priv->has_pressure = libevdev_has_event_code(proto_data->evdev, EV_ABS, ABS_PRESSURE);
     priv->has_width = libevdev_has_event_code(proto_data->evdev, EV_ABS, ABS_TOOL_WIDTH);
@@ -398,9 +378,9 @@ event_query_axis_ranges(InputInfoPtr pInfo)
         int st_maxy = priv->maxy;
 
         event_get_abs(proto_data->evdev, ABS_MT_POSITION_X, &priv->minx,
-                      &priv->maxx, &priv->synpara.hyst_x, &priv->resx);
+                      &priv->maxx, &priv->synpara->hyst_x, &priv->resx);
         event_get_abs(proto_data->evdev, ABS_MT_POSITION_Y, &priv->miny,
-                      &priv->maxy, &priv->synpara.hyst_y, &priv->resy);
+                      &priv->maxy, &priv->synpara->hyst_y, &priv->resy);
 
     }
 
@@ -450,7 +430,6 @@ SynapticsReadEvent(InputInfoPtr pInfo, struct input_event *ev)
     SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
     struct eventcomm_proto_data *proto_data = priv->proto_data;
     int rc;
-    static struct timeval last_event_time;
 
     rc = libevdev_next_event(proto_data->evdev, proto_data->read_flag, ev);
 
@@ -466,29 +445,23 @@ SynapticsReadEvent(InputInfoPtr pInfo, struct input_event *ev)
         return FALSE;
     }
 
-    /* SYN_DROPPED received in normal mode. Create a normal EV_SYN
-       so we process what's in the queue atm, then ensure we sync
-       next time */
+    /* SYN_DROPPED received in normal mode. It is passed on, EvFrameFeed()
+       processes what's in the queue atm with the time of the last frame,
+       then ensure we sync next time */
     if (rc == LIBEVDEV_READ_STATUS_SYNC &&
-        proto_data->read_flag == LIBEVDEV_READ_FLAG_NORMAL) {
+        proto_data->read_flag == LIBEVDEV_READ_FLAG_NORMAL)
         proto_data->read_flag = LIBEVDEV_READ_FLAG_SYNC;
-        ev->type = EV_SYN;
-        ev->code = SYN_REPORT;
-        ev->value = 0;
-        ev->time = last_event_time;
-
-    } else if (ev->type == EV_SYN)
-        last_event_time = ev->time;
 
     return TRUE;
 }
 
-inline static CARD32 get_time_ev_timestamp(struct eventcomm_proto_data *proto_data, struct timeval *tv){
+inline static CARD32 get_time_ev_timestamp(SynapticsPrivate *priv, struct timeval *tv){
+	struct eventcomm_proto_data *proto_data = priv->proto_data;
 
 	if (proto_data->have_monotonic_clock)
 		return 1000 * tv->tv_sec + tv->tv_usec / 1000;
 	else
-		return GetTimeInMillis();
+		return priv->clock->now(priv->clock);
 
 }
 
@@ -500,75 +473,22 @@ EventReadHwState(InputInfoPtr pInfo,
     struct input_event ev;
     struct SynapticsHwState *hw = comm->hwState;
     SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
-    SynapticsParameters *para = &priv->synpara;
     struct eventcomm_proto_data *proto_data = priv->proto_data;
 
     set_libevdev_log_handler();
 
     SynapticsResetTouchHwState(hw, FALSE);
 
-
     while (SynapticsReadEvent(pInfo, &ev)) {
-        switch (ev.type) {
-        case EV_SYN:
-            if(ev.code==SYN_REPORT){
-				hw->ev_time=get_time_ev_timestamp(proto_data, &ev.time);
-				SynapticsCopyHwState(hwRet, hw);
-                return TRUE;
-            }
-            break;
-        case EV_KEY:
-			if(ev.code==BTN_LEFT){
-				hw->left = (ev.value ? TRUE : FALSE);
-
-				// set btn_up_time
-				if(!ev.value){
-					// TODO: Set from props
-					priv->btn_up_time=200+get_time_ev_timestamp(proto_data, &ev.time);
-				}
-			}
-            break;
-        case EV_ABS:
-			if (ev.code == ABS_MT_SLOT) {
-				proto_data->cur_slot = ev.value;
-			}else{
-				int slot_index = proto_data->cur_slot;
-
-				// if slot index is 0 || 1
-				if ((slot_index|1)==1){
-
-					struct TouchData *hwt = hw->touches+slot_index;
-
-					if (hwt->slot_state == SLOTSTATE_OPEN_EMPTY)
-							hwt->slot_state = SLOTSTATE_UPDATE;
-
-					switch (ev.code){
-						case ABS_MT_TRACKING_ID:;
-							if(ev.value>=0){
-								hwt->slot_state = SLOTSTATE_OPEN;
-								hwt->x=0;
-								hwt->y=0;
-								hwt->z=0;
-								hwt->millis=get_time_ev_timestamp(proto_data, &ev.time);
-								priv->num_active_touches++;
-							}else if (hwt->slot_state != SLOTSTATE_EMPTY){
-								hwt->slot_state = SLOTSTATE_CLOSE;
-								priv->num_active_touches--;
-							}
-							break;
-						case ABS_MT_POSITION_X:
-							hwt->x=ev.value;
-							break;
-						case ABS_MT_POSITION_Y:
-							hwt->y=ev.value;
-							break;
-						case ABS_MT_PRESSURE:
-							hwt->z=ev.value;
-							break;
-					}
-				}
-			}
-            break;
+        if (EvFrameFeed(&priv->gs, &proto_data->cur_slot, hw,
+                        ev.type, ev.code, ev.value,
+                        get_time_ev_timestamp(priv, &ev.time))) {
+            /* libevdev's synced state ends with a SYN_REPORT of its own */
+            if (proto_data->read_flag == LIBEVDEV_READ_FLAG_SYNC &&
+                ev.code == SYN_REPORT)
+                priv->gs.counters[SYNAPTICS_CNT_RESYNCS]++;
+            SynapticsCopyHwState(hwRet, hw);
+            return TRUE;
         }
     }
     return FALSE;
@@ -585,7 +505,7 @@ static void
 event_query_touch(InputInfoPtr pInfo)
 {
     SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
-    SynapticsParameters *para = &priv->synpara;
+    SynapticsParameters *para = priv->synpara;
     struct eventcomm_proto_data *proto_data = priv->proto_data;
     struct libevdev *dev = proto_data->evdev;
     int axis;
@@ -0,0 +1,170 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <linux/input.h>
+#include <libevdev/libevdev.h>
+#include "evframe.h"
+
+/**
+ * Test if the device is recognized as touchpad device. Required bits for
+ * touchpad recognition are:
+ * - ABS_X + ABS_Y for absolute axes
+ * - ABS_PRESSURE or BTN_TOUCH
+ * - BTN_TOOL_FINGER
+ * - BTN_TOOL_PEN is _not_ set
+ *
+ * @return TRUE if the device is a touchpad or FALSE otherwise.
+ */
+Bool
+EvdevIsTouchpad(struct libevdev *evdev)
+{
+    /* Check for ABS_X, ABS_Y, ABS_PRESSURE and BTN_TOOL_FINGER */
+    if (!libevdev_has_event_type(evdev, EV_SYN) ||
+        !libevdev_has_event_type(evdev, EV_ABS) ||
+        !libevdev_has_event_type(evdev, EV_KEY))
+        return FALSE;
+
+    if (!libevdev_has_event_code(evdev, EV_ABS, ABS_X) ||
+        !libevdev_has_event_code(evdev, EV_ABS, ABS_Y))
+        return FALSE;
+
+    /* we expect touchpad either report raw pressure or touches */
+    if (!libevdev_has_event_code(evdev, EV_KEY, BTN_TOUCH) &&
+        !libevdev_has_event_code(evdev, EV_ABS, ABS_PRESSURE))
+        return FALSE;
+
+    /* all Synaptics-like touchpad report BTN_TOOL_FINGER */
+    if (!libevdev_has_event_code(evdev, EV_KEY, BTN_TOOL_FINGER) ||
+        libevdev_has_event_code(evdev, EV_ABS, BTN_TOOL_PEN)) /* Don't match wacom tablets */
+        return FALSE;
+
+    return TRUE;
+}
+
+/* the slot has a touch, i.e. counts in num_active_touches */
+static inline Bool
+slot_is_active(const struct TouchData *hwt)
+{
+    return hwt->slot_state == SLOTSTATE_OPEN ||
+        hwt->slot_state == SLOTSTATE_OPEN_EMPTY ||
+        hwt->slot_state == SLOTSTATE_UPDATE;
+}
+
+/**
+ * Fold one evdev event into hw. Touch and button changes also update the
+ * touch count and button release time kept in gs.
+ *
+ * @param cur_slot The current ABS_MT_SLOT, kept by the caller between calls
+ * @param millis Event time in milliseconds
+ *
+ * @return TRUE when the event completes a frame (SYN_REPORT or
+ * SYN_DROPPED), hw is then ready to be handed to the gesture engine.
+ */
+Bool
+EvFrameFeed(struct GestureState *gs, int *cur_slot,
+            struct SynapticsHwState *hw,
+            unsigned int type, unsigned int code, int value, CARD32 millis)
+{
+    gs->counters[SYNAPTICS_CNT_EVENTS]++;
+
+    switch (type) {
+    case EV_SYN:
+        if (code == SYN_REPORT) {
+            gs->counters[SYNAPTICS_CNT_FRAMES]++;
+            hw->ev_time = millis;
+            hw->dropped = FALSE;
+            return TRUE;
+        }
+        /* events were lost, what's there so far is processed with the
+           time of the last complete frame. The resync that follows is a
+           frame of its own. */
+        if (code == SYN_DROPPED) {
+            gs->counters[SYNAPTICS_CNT_DROPPED]++;
+            hw->dropped = TRUE;
+            return TRUE;
+        }
+        break;
+    case EV_KEY:
+		if(code==BTN_LEFT){
+			hw->left = (value ? TRUE : FALSE);
+
+			// set btn_up_time
+			if(!value){
+				// TODO: Set from props
+				gs->btn_up_time=200+millis;
+			}
+		}
+        break;
+    case EV_ABS:
+		if (code == ABS_MT_SLOT) {
+			*cur_slot = value;
+		}else{
+			int slot_index = *cur_slot;
+
+			// if slot index is 0 || 1
+			if ((slot_index|1)==1){
+
+				struct TouchData *hwt = hw->touches+slot_index;
+
+				if (hwt->slot_state == SLOTSTATE_OPEN_EMPTY)
+						hwt->slot_state = SLOTSTATE_UPDATE;
+
+				switch (code){
+					case ABS_MT_TRACKING_ID:;
+						// a new ID on a slot that is still tracked replaces
+						// the touch, only count the slot once; an end without
+						// a start (or a second one) is ignored
+						if(value>=0){
+							if(!slot_is_active(hwt))
+								gs->num_active_touches++;
+							hwt->slot_state = SLOTSTATE_OPEN;
+							hwt->x=0;
+							hwt->y=0;
+							hwt->z=0;
+							hwt->millis=millis;
+						}else if (slot_is_active(hwt)){
+							hwt->slot_state = SLOTSTATE_CLOSE;
+							gs->num_active_touches--;
+						}
+						break;
+					case ABS_MT_POSITION_X:
+						hwt->x=value;
+						break;
+					case ABS_MT_POSITION_Y:
+						hwt->y=value;
+						break;
+					case ABS_MT_PRESSURE:
+						hwt->z=value;
+						break;
+				}
+			}
+		}
+        break;
+    }
+
+    return FALSE;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _EVFRAME_H_
+#define _EVFRAME_H_
+
+/*
+ * Decoding of the evdev event stream into hardware frames, shared by the
+ * event and replay backends, and the touchpad check shared with synrecord.
+ * Like the gesture engine it doesn't depend on the X server.
+ */
+
+#include "gesture.h"
+
+struct libevdev;
+
+extern Bool EvdevIsTouchpad(struct libevdev *evdev);
+
+extern Bool EvFrameFeed(struct GestureState *gs, int *cur_slot,
+                        struct SynapticsHwState *hw,
+                        unsigned int type, unsigned int code, int value,
+                        CARD32 millis);
+
+#endif                          /* _EVFRAME_H_ */
@@ -0,0 +1,816 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * This driver is based on xf86-input-synaptics 1.8.1-1 driver. It is
+ * geared towards Lenovo XX40(T540/T440/X240/E440 etc) series laptops.
+ * Some features have been added and some have been discarded. See below
+ * for original license, authors and contributors.
+ *
+ * - Sergey Mosin <serge@sergem.org>
+ *
+ * ----------------------------------------------------------
+ *
+ * Copyright © 1999 Henry Davies
+ * Copyright © 2001 Stefan Gmeiner
+ * Copyright © 2002 S. Lehner
+ * Copyright © 2002 Peter Osterlund
+ * Copyright © 2002 Linuxcare Inc. David Kennedy
+ * Copyright © 2003 Hartwig Felger
+ * Copyright © 2003 Jörg Bösner
+ * Copyright © 2003 Fred Hucht
+ * Copyright © 2004 Alexei Gilchrist
+ * Copyright © 2004 Matthias Ihmig
+ * Copyright © 2006 Stefan Bethge
+ * Copyright © 2006 Christian Thaeter
+ * Copyright © 2007 Joseph P. Skudlarek
+ * Copyright © 2008 Fedor P. Goncharov
+ * Copyright © 2008-2012 Red Hat, Inc.
+ * Copyright © 2011 The Chromium OS Authors
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of Red Hat
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  Red
+ * Hat makes no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * Authors:
+ *      Joseph P. Skudlarek <Jskud@Jskud.com>
+ *      Christian Thaeter <chth@gmx.net>
+ *      Stefan Bethge <stefan.bethge@web.de>
+ *      Matthias Ihmig <m.ihmig@gmx.net>
+ *      Alexei Gilchrist <alexei@physics.uq.edu.au>
+ *      Jörg Bösner <ich@joerg-boesner.de>
+ *      Hartwig Felger <hgfelger@hgfelger.de>
+ *      Peter Osterlund <petero2@telia.com>
+ *      S. Lehner <sam_x@bluemail.ch>
+ *      Stefan Gmeiner <riddlebox@freesurf.ch>
+ *      Henry Davies <hdavies@ameritech.net> for the
+ *      Linuxcare Inc. David Kennedy <dkennedy@linuxcare.com>
+ *      Fred Hucht <fred@thp.Uni-Duisburg.de>
+ *      Fedor P. Goncharov <fedgo@gorodok.net>
+ *      Simon Thum <simon.thum@gmx.de>
+ *
+ * Trademarks are the property of their respective owners.
+ */
+
+/*
+ * The gesture engine, see gesture.h. Everything in here works on a
+ * struct GestureState and the current parameters only, the driver (or a
+ * tool) feeds it frames and timer expiries and receives the output through
+ * the sink.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+#include "gesture.h"
+
+static void
+post_motion(struct GestureState *gs, int dx, int dy)
+{
+    gs->counters[SYNAPTICS_CNT_MOTION_POSTS]++;
+    gs->sink->post_motion(gs->sink_data, dx, dy);
+}
+
+static void
+post_button(struct GestureState *gs, int button, Bool is_down)
+{
+    gs->counters[SYNAPTICS_CNT_BUTTON_POSTS]++;
+    gs->sink->post_button(gs->sink_data, button, is_down);
+}
+
+static void
+post_scroll(struct GestureState *gs, int dx, int dy)
+{
+    gs->counters[SYNAPTICS_CNT_SCROLL_POSTS]++;
+    gs->sink->post_scroll(gs->sink_data, dx, dy);
+}
+
+static void
+set_timer(struct GestureState *gs, CARD32 millis)
+{
+    gs->counters[millis ? SYNAPTICS_CNT_TIMER_ARMS : SYNAPTICS_CNT_TIMER_CANCELS]++;
+    gs->sink->set_timer(gs->sink_data, millis);
+}
+
+void
+GestureInit(struct GestureState *gs, const struct GestureSink *sink,
+            void *sink_data)
+{
+    memset(gs, 0, sizeof(*gs));
+    gs->sink = sink;
+    gs->sink_data = sink_data;
+    GestureReset(gs);
+}
+
+/* Forget all touches and pending taps, the timer is cancelled with the
+ * next frame */
+void
+GestureReset(struct GestureState *gs)
+{
+    int i;
+
+	gs->scroll_delta_x=0;
+	gs->scroll_delta_y=0;
+
+    gs->lastButtons = 0;
+    gs->num_active_touches = 0;
+
+    gs->go_scroll=FALSE;
+	gs->btn_up_time=0;
+
+    gs->timer_time=1;
+    gs->timer_click_mask=0;
+    gs->timer_click_finish=FALSE;
+    gs->timer_delta_x=0;
+    gs->timer_delta_y=0;
+    gs->timer_y_scroll=0;
+
+    gs->tap_start_time=0;
+
+	memset(gs->ns_info, 0,MAX_TP*sizeof(struct ns_inf));
+
+    for (i = 0; i < MAX_TP; i++)
+		gs->ns_info[i].touch_origin=TO_CLOSED;
+}
+
+/*
+ * Derived parameters.
+ *
+ * Some parameters are not used as set, they are converted to device
+ * coordinates first. Each derived node lists the raw inputs it depends on,
+ * GestureUpdateDerivedParameters() recomputes only the nodes with a dirty
+ * input.
+ */
+struct PadArea {
+    int minx, maxx, miny, maxy;
+};
+
+static void
+update_bottom_buttons(const struct PadArea *pad, SynapticsParameters *pars)
+{
+    int width = abs(pad->maxx - pad->minx);
+    int height = abs(pad->maxy - pad->miny);
+
+    pars->no_button_max_y=(100-pars->bottom_buttons_height)/100.0 * height + pad->miny;
+    pars->bottom_left_btn_rx=(pars->bottom_buttons_sep_pos-pars->bottom_buttons_sep_width/2) / 100.0 * width + pad->minx;
+    pars->bottom_right_btn_lx=(pars->bottom_buttons_sep_pos+pars->bottom_buttons_sep_width/2) / 100.0 * width + pad->minx;
+}
+
+static void
+update_top_buttons(const struct PadArea *pad, SynapticsParameters *pars)
+{
+    int width = abs(pad->maxx - pad->minx);
+    int height = abs(pad->maxy - pad->miny);
+
+    pars->no_button_min_y=pars->top_buttons_height/100.0 * height + pad->miny;
+    pars->top_mid_lx=(50-pars->top_buttons_middle_width/2) / 100.0 * width + pad->minx;
+    pars->top_mid_rx=(50+pars->top_buttons_middle_width/2) / 100.0 * width + pad->minx;
+}
+
+static void
+update_finger_radius(const struct PadArea *pad, SynapticsParameters *pars)
+{
+    int width = abs(pad->maxx - pad->minx);
+
+    pars->finger_radius=pars->scroll_twofinger_finger_size/100.0 * width;
+}
+
+static const struct {
+    unsigned int deps;
+    void (*update) (const struct PadArea *pad, SynapticsParameters *pars);
+} derived_params[] = {
+    { PD_DIMENSIONS | PD_BOTTOM_BUTTONS, update_bottom_buttons },
+    { PD_DIMENSIONS | PD_TOP_BUTTONS, update_top_buttons },
+    { PD_DIMENSIONS | PD_FINGER_SIZE, update_finger_radius },
+};
+
+void
+SynapticsCopyHwState(struct SynapticsHwState *dst,
+                     const struct SynapticsHwState *src)
+{
+	dst->left=src->left;
+	dst->ev_time=src->ev_time;
+	dst->dropped=src->dropped;
+    memcpy(dst->touches, src->touches, MAX_TP * sizeof(struct TouchData));
+
+}
+
+void
+SynapticsResetHwState(struct SynapticsHwState *hw)
+{
+    struct TouchData *hwt = hw->touches;
+    int i;
+	hw->left=FALSE;
+	hw->ev_time=0;
+	hw->dropped=FALSE;
+	for(i=0;i<MAX_TP;i++){
+		hwt->slot_state=SLOTSTATE_EMPTY;
+		hwt->x=0;
+		hwt->y=0;
+		hwt->z=0;
+		hwt->millis=0;
+		hwt++;
+	}
+}
+
+void
+SynapticsResetTouchHwState(struct SynapticsHwState *hw, Bool set_slot_empty)
+{
+
+	struct TouchData *hwt = hw->touches;
+	int i;
+    for (i = 0; i < MAX_TP; i++) {
+        switch (hwt->slot_state){
+        case SLOTSTATE_OPEN:
+        case SLOTSTATE_OPEN_EMPTY:
+        case SLOTSTATE_UPDATE:
+            hwt->slot_state = set_slot_empty ? SLOTSTATE_EMPTY : SLOTSTATE_OPEN_EMPTY;
+            break;
+        default:
+            hwt->slot_state = SLOTSTATE_EMPTY;
+            break;
+        }
+        hwt++;
+    }
+}
+
+/**
+ * Fill in the defaults for a device with the given ranges, i.e. the
+ * parameters the driver uses when no options are set. pars->hyst_x,
+ * hyst_y and clickpad are read as probed values, a hysteresis < 0 means
+ * none was probed. Derived parameters are left to
+ * GestureUpdateDerivedParameters().
+ */
+void
+GestureDefaultParameters(SynapticsParameters *pars,
+                         int minx, int maxx, int miny, int maxy,
+                         int minp, int maxp, int resx, int resy)
+{
+    int width, height, diag, range;
+
+    /* The synaptics specs specify typical edge widths of 4% on x, and 5.4% on
+     * y (page 7) [Synaptics TouchPad Interfacing Guide, 510-000080 - A
+     * Second Edition, http://www.synaptics.com/support/dev_support.cfm, 8 Sep
+     * 2008]. We use 7% for both instead for synaptics devices, and 15% for
+     * ALPS models.
+     * http://bugs.freedesktop.org/show_bug.cgi?id=21214
+     *
+     * If the range was autodetected, apply these edge widths to all four
+     * sides.
+     */
+
+    width = abs(maxx - minx);
+    height = abs(maxy - miny);
+    diag = sqrt(width * width + height * height);
+
+    /* Again, based on typical x/y range and defaults */
+    pars->scroll_dist_horiz = diag * .020;
+    pars->scroll_dist_vert = diag * .020;
+    pars->tap_move = diag * .044;
+    pars->accl = 200.0 / diag; /* trial-and-error */
+
+    /* hysteresis, assume >= 0 is a detected value (e.g. evdev fuzz) */
+    if (pars->hyst_x < 0)
+        pars->hyst_x = diag * 0.005;
+    if (pars->hyst_y < 0)
+        pars->hyst_y = diag * 0.005;
+
+    range = maxp - minp + 1;
+
+    /* scaling based on defaults and a pressure of 256 */
+    pars->finger_low = minp + range * (25.0 / 256);
+    pars->finger_high = minp + range * (30.0 / 256);
+    pars->press_motion_min_z = minp + range * (30.0 / 256);
+//    pars->press_motion_max_z = minp + range * (160.0 / 256);
+    pars->press_motion_max_z = 90;
+
+    /* Enable twofinger scroll if we can detect doubletap */
+    pars->scroll_twofinger_vert = FALSE;
+    pars->scroll_twofinger_horiz = FALSE;
+
+    pars->tap_time = 180;
+    pars->touchpad_off = TOUCHPAD_ON;
+    pars->min_speed = 0.4;
+    pars->max_speed = 0.7;
+    pars->press_motion_min_factor = 1.0;
+    pars->press_motion_max_factor = 10.0;
+
+    /* Use resolution reported by hardware if available */
+    pars->resolution_horiz = 1;
+    pars->resolution_vert = 1;
+    if ((resx > 0) && (resy > 0)) {
+        pars->resolution_horiz = resx;
+        pars->resolution_vert = resy;
+    }
+
+    pars->bottom_buttons_height = 25;
+	pars->bottom_buttons_sep_pos = 50;
+	pars->bottom_buttons_sep_width = 2;
+
+	pars->top_buttons_height = 15;
+	pars->top_buttons_middle_width = 16;
+
+	pars->scroll_twofinger_finger_size = 18;
+
+	pars->tap_pressure = 50;
+	pars->tap_anywhere = 0;
+	pars->tap_hold = 160;
+
+	pars->typing_timeout = 500;
+}
+
+void
+GestureUpdateDerivedParameters(SynapticsParameters *pars,
+                               int minx, int maxx, int miny, int maxy,
+                               unsigned int dirty)
+{
+    struct PadArea pad = { minx, maxx, miny, maxy };
+    int i;
+
+    if (!dirty)
+        return;
+
+    for (i = 0; i < sizeof(derived_params) / sizeof(derived_params[0]); i++) {
+        if (derived_params[i].deps & dirty)
+            derived_params[i].update(&pad, pars);
+    }
+}
+
+static enum TouchOrigin
+current_button_area_new(const SynapticsParameters *para, int x, int y, struct ns_inf *pti)
+{
+		if(y<para->no_button_min_y){
+			pti->vert_area=VA_TOP;
+			if(x<para->top_mid_lx) return TO_LEFT_CLICK;
+			else if(x>para->top_mid_rx) return TO_RIGHT_CLICK;
+			else return TO_MIDDLE_CLICK;
+		}else if (y>para->no_button_max_y){
+			pti->vert_area=VA_BOT;
+			if(x<para->bottom_left_btn_rx) return TO_LEFT_CLICK;
+			else if(x>para->bottom_right_btn_lx) return TO_RIGHT_CLICK;
+			else return TO_BTN_GAP;
+		}else{
+			pti->vert_area=VA_MID;
+			return TO_NO_CLICK;
+		}
+}
+static void inline
+timerClick(struct GestureState *gs, const SynapticsParameters *para,
+           struct ns_inf *pti){
+
+	if(gs->timer_click_finish){
+		post_button(gs, gs->timer_click_mask, FALSE);
+		gs->timer_click_finish=FALSE;
+		gs->timer_click_mask=0;
+	}else if(!gs->timer_click_mask){
+		// the other touch's tap already used the click
+		pti->tap_state=TS_NONE;
+	}else if(gs->timer_delta_x<para->tap_move && gs->timer_delta_y<para->tap_move){
+		post_button(gs, gs->timer_click_mask, TRUE);
+		pti->tap_state=TS_NONE;
+		// 5 mills tap length
+		set_timer(gs, 5);
+		gs->timer_click_finish=TRUE;
+		gs->timer_time=0;
+	}
+
+}
+
+static void
+post_scroll_events(struct GestureState *gs)
+{
+    if (gs->scroll_delta_x || gs->scroll_delta_y)
+        post_scroll(gs, gs->scroll_delta_x, gs->scroll_delta_y);
+}
+
+/* The timer requested through the sink expired */
+void
+GestureTimer(struct GestureState *gs, const SynapticsParameters *para)
+{
+    struct ns_inf *pti = gs->ns_info;
+	int i=0;
+
+	gs->counters[SYNAPTICS_CNT_TIMER_FIRES]++;
+
+	// finish click if needed;
+	if(gs->timer_click_finish){
+		timerClick(gs,para,NULL);
+		i=1; //<-- so we don't go into THG loop
+	};
+
+	if(gs->timer_y_scroll){
+		// hand cont. scroll
+
+		if(gs->timer_y_scroll>0) gs->timer_y_scroll-=50;
+		else gs->timer_y_scroll+=50;
+
+		if(abs(gs->timer_y_scroll)>50){
+
+			post_scroll(gs, 0, gs->timer_y_scroll);
+			set_timer(gs, 64);
+
+		} else gs->timer_y_scroll=0;
+
+		gs->timer_time=0;
+
+	}else if(!i){
+		// handle THG
+
+		for(i=0;i<MAX_TP;i++){
+			if(pti->tap_state==TS_WAIT){
+				timerClick(gs,para,pti);
+			}else if(pti->tap_state==TS_THG_WAIT){
+				pti->tap_state=TS_THG; // we are now in THG mode
+			}
+			pti++;
+		}
+
+		gs->timer_time=0;
+
+	}
+}
+
+
+/**
+ * Applies hysteresis. center is shifted such that it is in range with
+ * in by the margin again. The new center is returned.
+ * @param in the current value
+ * @param center the current center
+ * @param margin the margin to center in which no change is applied
+ * @return the new center (which might coincide with the previous)
+ */
+static int
+hysteresis(int in, int center, int margin)
+{
+    int diff = in - center;
+
+    if (abs(diff) <= margin) {
+        diff = 0;
+    }
+    else if (diff > margin) {
+        diff -= margin;
+    }
+    else if (diff < -margin) {
+        diff += margin;
+    }
+    return center + diff;
+}
+
+static void
+post_button_click(struct GestureState *gs, const int button)
+{
+    post_button(gs, button, TRUE);
+    post_button(gs, button, FALSE);
+}
+
+static void
+filter_jitter(const SynapticsParameters *para, int *x, int *y,
+              struct ns_inf *pti)
+{
+    pti->hyst_center_x = hysteresis(*x, pti->hyst_center_x, para->hyst_x);
+    pti->hyst_center_y = hysteresis(*y, pti->hyst_center_y, para->hyst_y);
+    *x = pti->hyst_center_x;
+    *y = pti->hyst_center_y;
+}
+
+/*
+ * React on changes in the hardware state. This function is called every time
+ * the hardware state changes.
+ */
+void
+GestureHandleState(struct GestureState *gs, const SynapticsParameters *para,
+                   struct SynapticsHwState *hw)
+{
+    struct TouchData *hwt;
+    struct ns_inf *pti;
+    int dx = 0, dy = 0, buttons=0,id;
+    int change;
+
+	int temp=0;
+	int new_two_down=0;
+
+	int i;
+	int x,y;
+	enum TouchOrigin cba;
+	int potential_click=0;
+	Bool typing, tap;
+
+	gs->scroll_delta_y=0;
+	gs->scroll_delta_x=0;
+
+	// syndaemon
+	if(para->touchpad_off==TOUCHPAD_OFF){
+		gs->counters[SYNAPTICS_CNT_OFF_FRAMES]++;
+		goto timer;
+	}
+
+	// a key was pressed recently, palms on the pad must not tap or move
+	typing=para->typing_timeout && gs->last_key_time &&
+		(INT32)(hw->ev_time-gs->last_key_time) < para->typing_timeout;
+
+	for (i = 0; i < MAX_TP; i++) {
+
+		hwt=&hw->touches[i];
+		pti=&gs->ns_info[i];
+
+		// slot is empty
+		if(!hwt->slot_state) continue;
+
+        if (hwt->slot_state == SLOTSTATE_CLOSE){
+
+			// tap_anywhere option
+			if(!pti->touch_origin) pti->touch_origin+=para->tap_anywhere;
+
+			// handle tap
+			tap=para->touchpad_off!=TOUCHPAD_TAP_OFF && pti->tap_go && !pti->typing &&
+				(pti->tap_state==TS_THG || // <-- we are in THG mode
+				pti->touch_origin>TO_NO_CLICK && // <-- first tap or second with timer ON
+				(hw->ev_time - hwt->millis) < para->tap_time &&
+				abs(pti->org_x-pti->hist_x)<para->tap_move &&
+				abs(pti->org_y-pti->hist_y)<para->tap_move);
+
+			// button click delay
+			if(tap && pti->tap_state!=TS_THG && hw->ev_time <= gs->btn_up_time){
+				tap=FALSE;
+				gs->counters[SYNAPTICS_CNT_CLICK_TAPS]++;
+			}
+
+			if(tap){
+
+				switch(pti->tap_state){
+					case TS_NONE: // first tap release
+						if(!para->tap_hold){
+							post_button_click(gs, ffs(pti->touch_origin));
+							break;
+						}
+						if(pti->triple_click_timeout>hw->ev_time)
+							timerClick(gs,para,pti);
+						else{
+							gs->timer_click_mask=ffs(pti->touch_origin);
+							gs->timer_time=para->tap_hold; // <-Start THG timer
+							pti->tap_state=TS_WAIT;
+							gs->timer_delta_x=0;
+							gs->timer_delta_y=0;
+						}
+						pti->triple_click_timeout=0;
+						break;
+					case TS_WAIT: // <-- this gets switched by the timer(TS_NONE + clicked) or if we touch down(TS_THG_WAIT/TS_NONE)
+					case TS_THG_WAIT: // released before timers switched into THG
+						// need to double(posibly triple) tap here and
+						pti->triple_click_timeout=hw->ev_time+para->tap_time;
+						// do fist tap, in TS_THG_WAIT its press was posted on touch down
+						if(pti->tap_state==TS_WAIT)
+							post_button(gs, gs->timer_click_mask, TRUE);
+						post_button(gs, gs->timer_click_mask, FALSE);
+						// start next tap
+						post_button(gs, gs->timer_click_mask, TRUE);
+					case TS_THG: // released after THG or coming from TS_THG_WAIT
+						post_button(gs, gs->timer_click_mask, FALSE);
+						if(!pti->triple_click_timeout) gs->timer_click_mask=0;
+						gs->timer_time=1; // to be reset
+						pti->tap_state=TS_NONE;
+						//~ post_button(gs, gs->timer_click_mask, TRUE);
+						break;
+				}
+			}else if(pti->tap_state==TS_THG_WAIT || pti->tap_state==TS_THG){
+				// not a tap after all (moved, held or typing), the button
+				// pressed on touch down must not stay down
+				post_button(gs, gs->timer_click_mask, FALSE);
+				gs->timer_click_mask=0;
+				gs->timer_time=1;
+				pti->tap_state=TS_NONE;
+			}
+
+			// clean up
+
+			hwt->millis=0;
+			pti->touch_origin=TO_CLOSED;
+			pti->vert_area=0;
+			pti->hist_x=0;
+			pti->hist_y=0;
+			pti->tap_go=FALSE;
+			pti->typing=FALSE;
+			gs->go_scroll=FALSE;
+
+			// clear tap_start_time / cont. scroll ?
+			if(!gs->num_active_touches){
+				if(para->tap_anywhere) gs->tap_start_time=0;
+				if(gs->timer_y_scroll) gs->timer_time=20;
+			}
+
+			continue;
+		}
+
+		x=hwt->x;
+		y=hwt->y;
+
+		// if we don't know X & Y than assume potential left button and go to next finger
+		if(!x || !y){
+			potential_click|=1;
+			continue;
+		}
+
+		// low pressure
+		if(hwt->z < para->finger_low) continue;
+
+		// At this point X, Y and Z are good
+
+		filter_jitter(para, &x, &y, pti);
+		cba=current_button_area_new(para,x,y,pti);
+
+		//set touch origin, history and new_two_down if new touch
+		if(pti->touch_origin<TO_BTN_GAP){
+			pti->touch_origin=cba;
+
+			// set history so first deltas are 0's
+			pti->hist_x=x;
+			pti->hist_y=y;
+
+			// if two down check for scroll later
+			new_two_down=gs->num_active_touches;
+
+			pti->typing=typing;
+		}
+
+		//tap pressure reached handle THG mode
+		if(!pti->tap_go && !pti->typing && !gs->go_scroll && hwt->z > para->tap_pressure){
+			pti->tap_go=TRUE;
+
+			// move delay if tap_anywhere is enabled
+			if(para->tap_anywhere && !gs->tap_start_time) gs->tap_start_time=hw->ev_time+120;
+
+			// turn off cont. scroll if any
+			if(gs->timer_y_scroll){
+				gs->timer_y_scroll=0;
+				gs->timer_time=1;
+			}
+
+			// set tap origin coords
+			pti->org_x=x;
+			pti->org_y=y;
+
+			// THG stuff
+			if(pti->tap_state==TS_WAIT){
+
+				int tto;
+				//~ =!pti->touch_origin?pti->touch_origin+para->tap_anywhere:pti->touch_origin;
+
+				// tap_anywhere THG move restrict
+				if(para->tap_anywhere && !pti->touch_origin &&
+					gs->timer_delta_x<para->tap_move && gs->timer_delta_y<para->tap_move){
+					tto=1;
+				}else tto=pti->touch_origin;
+
+
+				if(ffs(tto)==gs->timer_click_mask){ // <-- tap origin is the same
+					post_button(gs, gs->timer_click_mask, TRUE);
+					pti->tap_state=TS_THG_WAIT;
+					gs->timer_time=para->tap_time; // set timer to change to TS_THG if tap time expires
+
+				}else{ // <-- tap origing diferent
+					timerClick(gs, para, pti);
+					// set timer to reset
+					// gs->timer_time=1;
+				}
+			}
+		}
+
+		//scroll delta
+		gs->scroll_delta_x+=(x-pti->hist_x);
+		gs->scroll_delta_y+=(y-pti->hist_y);
+
+		// is move allowed
+		if(!pti->typing && (!pti->touch_origin || (!cba && gs->num_active_touches<2))){
+			// move deltas
+			dx+=(x-pti->hist_x);
+			dy+=(y-pti->hist_y);
+		}else if(cba>0){
+			// set potential_click if we are in a button area
+			potential_click|=cba;
+		}
+
+		// set history
+		pti->hist_x=x;
+		pti->hist_y=y;
+	}
+
+	if(hw->left){
+		// handle clicks ----
+
+		buttons=gs->lastButtons;
+
+		// ziro potential_click if gs->lastButtons
+		potential_click&=-(gs->lastButtons==0);
+
+		// buttons = potential_click if lastButtons==0
+		buttons|=potential_click;
+
+	}else if(gs->go_scroll ||
+		(new_two_down==2 &&
+		(gs->ns_info[0].vert_area==gs->ns_info[1].vert_area ||
+		(abs(gs->ns_info[0].hist_x-gs->ns_info[1].hist_x)<para->finger_radius &&
+		abs(gs->ns_info[0].hist_y-gs->ns_info[1].hist_y)<para->finger_radius)))){
+		/* Handle Scroll IF
+		* - already in the scroll mode
+		* - new two finger touch and
+		* - both fingers are in the same area or fingers are close together
+		* */
+
+		// if syndaemon allows scroll than scroll
+		if(para->touchpad_off!=TOUCHPAD_TAP_OFF){
+			int abs_sdy=abs(gs->scroll_delta_y);
+
+			// scroll either y OR x
+			temp=(abs_sdy-abs(gs->scroll_delta_x))>>INT_SHIFT;
+			gs->scroll_delta_x&=temp;
+			gs->scroll_delta_y&=~temp;
+
+
+			//apply scroll Endable/Disable settings
+			if(!para->scroll_twofinger_vert) gs->scroll_delta_y=0;
+			if(!para->scroll_twofinger_horiz) gs->scroll_delta_x=0;
+
+			post_scroll_events(gs);
+
+			// cont. scroll if sdy>150
+			gs->timer_y_scroll=gs->scroll_delta_y&((150-abs_sdy)>>INT_SHIFT);
+		}
+
+		gs->go_scroll=TRUE;
+
+		// no move if scroll or attempt to scroll when TOUCHPAD_TAP_OFF
+		temp=1;
+	}
+
+
+	// reuse x and y vars
+	x=abs(dx);
+	y=abs(dy);
+
+	// no move if to much delta
+	if((x>400)|(y>400)){
+		temp=1;
+		gs->counters[SYNAPTICS_CNT_JUMPS]++;
+	}
+	// no motion if button was just clicked
+	temp|=(hw->ev_time<gs->btn_up_time);
+	// no motion while typing
+	temp|=typing;
+
+	// deal with tap_anywhere
+	if(para->tap_anywhere && gs->tap_start_time>1){
+		// stabilize tap - cancel move only if deltas are small and within the delay time (120ms)
+		if (x>para->hyst_x || y>para->hyst_y) gs->tap_start_time=1;
+		else if(hw->ev_time<gs->tap_start_time) temp=1;
+		else gs->tap_start_time=1;
+	}
+	// post motion ----------
+    if ((dx || dy) && !temp){
+
+		// TGH stuff
+		if((gs->ns_info[0].tap_state|gs->ns_info[1].tap_state)==1){
+			gs->timer_delta_x+=dx;
+			gs->timer_delta_y+=dy;
+		}
+
+		post_motion(gs, dx, dy);
+	}
+
+	// post clicks ----------
+    change = buttons ^ gs->lastButtons;
+    while (change) {
+        id = ffs(change);       /* number of first set bit 1..32 is returned */
+        change &= ~(1 << (id - 1));
+        post_button(gs, id, (buttons & (1 << (id - 1))));
+    }
+
+    // Save old buttons
+    gs->lastButtons = buttons;
+
+ timer:
+    // timer request of this frame, 1 cancels a running timer
+    if(gs->timer_time){
+		set_timer(gs, gs->timer_time>1 ? gs->timer_time : 0);
+		gs->timer_time=0;
+	}
+}
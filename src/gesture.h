@@ -0,0 +1,242 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _GESTURE_H_
+#define _GESTURE_H_
+
+/*
+ * The gesture engine: turns hardware frames into pointer motion, button,
+ * scroll and timer requests. It doesn't depend on the X server, output goes
+ * through a GestureSink so the same code runs in the driver and in tools.
+ */
+
+#include <limits.h>
+#include <X11/Xdefs.h>
+#include <X11/Xmd.h>
+
+#include "synaptics-properties.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+#define MAX_TP 2 /* Max track points*/
+
+static const int INT_SHIFT = sizeof(int)*CHAR_BIT-1;
+
+enum OffState {
+    TOUCHPAD_ON = 0,
+    TOUCHPAD_OFF = 1,
+    TOUCHPAD_TAP_OFF = 2,
+};
+
+enum SynapticsSlotState {
+    SLOTSTATE_EMPTY = 0,        /* no slot in this cycle */
+    SLOTSTATE_OPEN,             /* tracking ID received */
+    SLOTSTATE_CLOSE,            /* tracking ID -1 received */
+    SLOTSTATE_OPEN_EMPTY,       /* previously had tracking id, no events in this read cycle */
+    SLOTSTATE_UPDATE,           /* had tracking id, other events in this cycle */
+};
+
+struct TouchData{
+	enum SynapticsSlotState slot_state;
+	int x;
+	int y;
+	int z;
+	CARD32 millis;              /* Timestamp in milliseconds */
+};
+/*
+ * A structure to describe the state of the touchpad hardware (buttons and pad)
+ */
+struct SynapticsHwState {
+	struct TouchData *touches;
+    CARD32 ev_time;
+    Bool left;
+    Bool dropped;               /* ended by SYN_DROPPED, ev_time is the last frame's */
+};
+
+enum TouchOrigin{
+	TO_CLOSED=-2,
+	TO_BTN_GAP=-1,
+	TO_NO_CLICK=0,
+	TO_LEFT_CLICK=1,
+	TO_MIDDLE_CLICK=2,
+	TO_RIGHT_CLICK=4
+};
+
+enum VertArea{
+	VA_NO,		// not defined
+	VA_TOP,		// top button area
+	VA_MID,		// no click area
+	VA_BOT		// buttom bnt area
+};
+
+enum TapState{
+	TS_NONE,
+	TS_WAIT,		// waiting for to fire click - timer is ON
+	TS_THG_WAIT,		// button down fired - timer is ON to switch state to TS_THG
+	TS_THG			// we are in THG mode - timer is OFF
+};
+
+struct ns_inf{ // perfinger tracking info
+	int hist_x;
+	int hist_y;
+	int org_x;		// touch origin x
+	int org_y;		// touch origin y
+	CARD32 triple_click_timeout;
+    int hyst_center_x;          /* center x of hysteresis */
+    int hyst_center_y;          /* center y of hysteresis */
+	enum TouchOrigin touch_origin;
+	int vert_area;				// for scroll stuff;
+	enum TapState tap_state;
+	Bool tap_go;				// tap pressure breached
+	Bool typing;				// touch began while typing, never taps or moves
+};
+
+/* Raw inputs of the derived parameters, see UpdateDerivedParameters() */
+enum ParamDeps {
+    PD_DIMENSIONS = 1 << 0,     /* minx, maxx, miny, maxy */
+    PD_BOTTOM_BUTTONS = 1 << 1, /* bottom_buttons_* */
+    PD_TOP_BUTTONS = 1 << 2,    /* top_buttons_* */
+    PD_FINGER_SIZE = 1 << 3,    /* scroll_twofinger_finger_size */
+    PD_ALL = (1 << 4) - 1
+};
+
+typedef struct _SynapticsParameters {
+    int finger_low, finger_high; //, finger_press;  /* finger detection values in Z-values */
+    int tap_time;
+    int tap_move;               /* max. tapping time and movement in packets and coord. */
+    Bool clickpad;              /* Device is a has integrated buttons */
+    int scroll_dist_vert;       /* Scrolling distance in absolute coordinates */
+    int scroll_dist_horiz;      /* Scrolling distance in absolute coordinates */
+    Bool scroll_twofinger_vert; /* Enable/disable vertical two-finger scrolling */
+    Bool scroll_twofinger_horiz;        /* Enable/disable horizontal two-finger scrolling */
+    double min_speed, max_speed, accl;  /* movement parameters */
+    int touchpad_off;           /* Switches the touchpad off
+                                 * 0 : Not off
+                                 * 1 : Off
+                                 * 2 : Only tapping and scrolling off
+                                 */
+    int press_motion_min_z;     /* finger pressure at which minimum pressure motion factor is applied */
+    int press_motion_max_z;     /* finger pressure at which maximum pressure motion factor is applied */
+    double press_motion_min_factor;     /* factor applied on speed when finger pressure is at minimum */
+    double press_motion_max_factor;     /* factor applied on speed when finger pressure is at maximum */
+    Bool grab_event_device;     /* grab event device for exclusive use? */
+    unsigned int resolution_horiz;      /* horizontal resolution of touchpad in units/mm */
+    unsigned int resolution_vert;       /* vertical resolution of touchpad in units/mm */
+    int hyst_x, hyst_y;         /* x and y width of hysteresis box */
+
+    int bottom_buttons_height;				// default = 25%
+	int bottom_buttons_sep_pos;				// default = 50%
+	int bottom_buttons_sep_width;			// default = 2%
+	// calculated
+    int no_button_max_y;		// Bottom edge of no button area
+    int bottom_left_btn_rx;		// right edge of bottom left button
+    int bottom_right_btn_lx;	// left edge of bottom right button
+
+	int top_buttons_height; 				// default = 15%
+	int top_buttons_middle_width; 			// default = 16%
+	// calculated
+    int no_button_min_y;		// Bottom edge of no button area
+	int top_mid_lx;				// left edge of top middle button
+	int top_mid_rx;				// right edge of top middle button
+
+	int scroll_twofinger_finger_size; 		//Finger Box Size, default = 18%
+	// calculated
+    int finger_radius;			// size of finger box for scrolling...
+
+	int tap_pressure; 						// default = 50;
+	int tap_anywhere;						// 0-disable, 1 - enable
+	int tap_hold;							// Tap Hold Gesture - default timeOut=150 in ms/0-disable
+
+	int typing_timeout;						// ms after a key press without taps/motion, 0-disable
+
+} SynapticsParameters;
+
+/* Output of the engine, all calls happen from inside GestureHandleState()
+ * and GestureTimer(). */
+struct GestureSink {
+    void (*post_motion) (void *data, int dx, int dy);
+    void (*post_button) (void *data, int button, Bool is_down);
+    void (*post_scroll) (void *data, int dx, int dy);
+    /* (re)arm the single engine timer to fire in millis, 0 cancels it */
+    void (*set_timer) (void *data, CARD32 millis);
+};
+
+struct GestureState {
+    const struct GestureSink *sink;
+    void *sink_data;
+
+    /* inputs maintained by the caller */
+    int num_active_touches;     /* Number of active touches on device */
+    CARD32 btn_up_time;         /* when button was released */
+    CARD32 last_key_time;       /* last key press on the typing keyboard, 0 if none */
+
+    int scroll_delta_x;         /* accumulated horiz scroll delta */
+	int scroll_delta_y;         /* accumulated vert scroll delta */
+
+	int lastButtons;
+
+	struct ns_inf ns_info[MAX_TP];
+	Bool go_scroll;
+
+    CARD32 timer_time;			// timer request of the current frame, 1 cancels
+    int timer_click_mask;
+    Bool timer_click_finish;
+
+    int timer_delta_x;			// deltas while waiting to tap
+    int timer_delta_y;
+
+    int timer_y_scroll;			// cont y scroll
+
+    CARD32 tap_start_time;		// let's call this tap_anywhere stabilizer timeout
+
+    /* SYNAPTICS_PROP_COUNTERS, also counted by EvFrameFeed() and the
+     * driver. GestureReset() leaves them alone. */
+    CARD32 counters[SYNAPTICS_CNT_COUNT];
+};
+
+extern void GestureInit(struct GestureState *gs,
+                        const struct GestureSink *sink, void *sink_data);
+extern void GestureReset(struct GestureState *gs);
+extern void GestureHandleState(struct GestureState *gs,
+                               const SynapticsParameters *para,
+                               struct SynapticsHwState *hw);
+extern void GestureTimer(struct GestureState *gs,
+                         const SynapticsParameters *para);
+extern void GestureDefaultParameters(SynapticsParameters *pars,
+                                     int minx, int maxx, int miny, int maxy,
+                                     int minp, int maxp, int resx, int resy);
+extern void GestureUpdateDerivedParameters(SynapticsParameters *pars,
+                                           int minx, int maxx,
+                                           int miny, int maxy,
+                                           unsigned int dirty);
+
+extern void SynapticsCopyHwState(struct SynapticsHwState *dst,
+                                 const struct SynapticsHwState *src);
+extern void SynapticsResetHwState(struct SynapticsHwState *hw);
+extern void SynapticsResetTouchHwState(struct SynapticsHwState *hw,
+                                       Bool set_slot_empty);
+
+#endif                          /* _GESTURE_H_ */
@@ -0,0 +1,227 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include "player.h"
+#include "evframe.h"
+
+/* the integer options a corpus script may set, under their xorg.conf
+   names */
+static const struct {
+    const char *name;
+    size_t offset;
+} script_options[] = {
+    { "FingerLow", offsetof(SynapticsParameters, finger_low) },
+    { "MaxTapTime", offsetof(SynapticsParameters, tap_time) },
+    { "MaxTapMove", offsetof(SynapticsParameters, tap_move) },
+    { "VertTwoFingerScroll", offsetof(SynapticsParameters, scroll_twofinger_vert) },
+    { "HorizTwoFingerScroll", offsetof(SynapticsParameters, scroll_twofinger_horiz) },
+    { "TouchpadOff", offsetof(SynapticsParameters, touchpad_off) },
+    { "BottomButtonsHeight", offsetof(SynapticsParameters, bottom_buttons_height) },
+    { "TopButtonsHeight", offsetof(SynapticsParameters, top_buttons_height) },
+    { "TwoFingerScrollFingerSize", offsetof(SynapticsParameters, scroll_twofinger_finger_size) },
+    { "MinTapPressure", offsetof(SynapticsParameters, tap_pressure) },
+    { "TapAnywhere", offsetof(SynapticsParameters, tap_anywhere) },
+    { "TapHoldGuesture", offsetof(SynapticsParameters, tap_hold) },
+};
+
+static void
+player_post_motion(void *data, int dx, int dy)
+{
+    struct FramePlayer *player = data;
+
+    player->out->post_motion(player->out_data, dx, dy);
+}
+
+static void
+player_post_button(void *data, int button, Bool is_down)
+{
+    struct FramePlayer *player = data;
+
+    player->out->post_button(player->out_data, button, is_down);
+}
+
+static void
+player_post_scroll(void *data, int dx, int dy)
+{
+    struct FramePlayer *player = data;
+
+    player->out->post_scroll(player->out_data, dx, dy);
+}
+
+static void
+player_timer_expired(void *arg)
+{
+    struct FramePlayer *player = arg;
+
+    GestureTimer(&player->gs, player->para);
+}
+
+static void
+player_set_timer(void *data, CARD32 millis)
+{
+    struct FramePlayer *player = data;
+
+    player->sim.clock.set_timer(&player->sim.clock, millis,
+                                player_timer_expired, player);
+}
+
+static const struct GestureSink player_sink = {
+    player_post_motion,
+    player_post_button,
+    player_post_scroll,
+    player_set_timer
+};
+
+/**
+ * Set up the parameters the driver uses for dev when no options are set.
+ */
+void
+PlayerParameters(SynapticsParameters *para, const struct RecordDevice *dev)
+{
+    int minp = 0, maxp = 255;
+
+    memset(para, 0, sizeof(*para));
+    para->hyst_x = dev->hyst_x;
+    para->hyst_y = dev->hyst_y;
+    para->clickpad = dev->clickpad;
+    if (dev->has_pressure) {
+        minp = dev->minp;
+        maxp = dev->maxp;
+    }
+    GestureDefaultParameters(para, dev->minx, dev->maxx, dev->miny, dev->maxy,
+                             minp, maxp, dev->resx, dev->resy);
+    GestureUpdateDerivedParameters(para, dev->minx, dev->maxx,
+                                   dev->miny, dev->maxy, PD_ALL);
+}
+
+/**
+ * Apply the option lines of a corpus script (see test/mkrec.c) on top of
+ * what PlayerParameters() set up for dev. Problems are reported to log.
+ *
+ * @return FALSE if the script can't be read or sets an unknown option.
+ */
+Bool
+PlayerScriptOptions(SynapticsParameters *para, const struct RecordDevice *dev,
+                    const char *script, FILE *log)
+{
+    char line[1024];
+    FILE *f;
+    Bool ok = TRUE;
+
+    f = fopen(script, "r");
+    if (!f) {
+        fprintf(log, "Can't open %s: %s\n", script, strerror(errno));
+        return FALSE;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        char name[64];
+        int value, i;
+
+        if (sscanf(line, " option %63s %d", name, &value) != 2)
+            continue;
+
+        for (i = 0; i < sizeof(script_options) / sizeof(script_options[0]); i++)
+            if (!strcmp(name, script_options[i].name))
+                break;
+        if (i == sizeof(script_options) / sizeof(script_options[0])) {
+            fprintf(log, "%s: unknown option %s\n", script, name);
+            ok = FALSE;
+            continue;
+        }
+        *(int *) ((char *) para + script_options[i].offset) = value;
+    }
+    fclose(f);
+
+    GestureUpdateDerivedParameters(para, dev->minx, dev->maxx,
+                                   dev->miny, dev->maxy, PD_ALL);
+
+    return ok;
+}
+
+/**
+ * Start a player with the clock at now, usually the time of the first
+ * event. para must stay valid while the player is used.
+ */
+void
+PlayerInit(struct FramePlayer *player, const SynapticsParameters *para,
+           CARD32 now, const struct GestureSink *out, void *out_data)
+{
+    memset(player, 0, sizeof(*player));
+    SimClockInit(&player->sim, now);
+    GestureInit(&player->gs, &player_sink, player);
+    player->para = para;
+    player->out = out;
+    player->out_data = out_data;
+
+    player->acc.touches = player->acc_touches;
+    player->frame.touches = player->frame_touches;
+    SynapticsResetHwState(&player->acc);
+    SynapticsResetHwState(&player->frame);
+}
+
+/**
+ * Feed one evdev event. The clock moves to millis first, so a timer due
+ * before the event fires before it.
+ *
+ * @return TRUE if the event completed a frame and the engine handled it.
+ */
+Bool
+PlayerFeed(struct FramePlayer *player,
+           unsigned int type, unsigned int code, int value, CARD32 millis)
+{
+    if (!player->in_frame) {
+        SynapticsResetTouchHwState(&player->acc, FALSE);
+        player->in_frame = TRUE;
+    }
+
+    SimClockAdvance(&player->sim, millis);
+
+    if (!EvFrameFeed(&player->gs, &player->cur_slot, &player->acc,
+                     type, code, value, millis))
+        return FALSE;
+
+    SynapticsCopyHwState(&player->frame, &player->acc);
+    GestureHandleState(&player->gs, player->para, &player->frame);
+    player->in_frame = FALSE;
+    player->frames++;
+
+    return TRUE;
+}
+
+/**
+ * Let the engine finish what the last frame started, i.e. run the timers
+ * due within limit ms.
+ */
+void
+PlayerFinish(struct FramePlayer *player, CARD32 limit)
+{
+    SimClockAdvance(&player->sim, player->sim.now + limit);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _PLAYER_H_
+#define _PLAYER_H_
+
+/*
+ * A driver instance without the X server for the tools and tests: evdev
+ * events go through EvFrameFeed() and the gesture engine the way
+ * EventReadHwState() and ReadInput() do it, time comes from a simulated
+ * clock. Instances don't share any state.
+ */
+
+#include <stdio.h>
+#include "gesture.h"
+#include "clock.h"
+#include "record.h"
+
+struct FramePlayer {
+    struct SimClock sim;
+    struct GestureState gs;
+    const SynapticsParameters *para;
+
+    /* where the engine's motion, button and scroll posts go, set_timer
+       isn't used */
+    const struct GestureSink *out;
+    void *out_data;
+
+    /* the frame being read and the one handed to the engine, like
+       comm->hwState and priv->local_hw_state; hw points into the
+       player, it must not be copied once initialized */
+    struct TouchData acc_touches[MAX_TP];
+    struct TouchData frame_touches[MAX_TP];
+    struct SynapticsHwState acc;
+    struct SynapticsHwState frame;
+    int cur_slot;
+    Bool in_frame;
+
+    unsigned long frames;       /* frames handled so far */
+};
+
+extern void PlayerParameters(SynapticsParameters *para,
+                             const struct RecordDevice *dev);
+extern Bool PlayerScriptOptions(SynapticsParameters *para,
+                                const struct RecordDevice *dev,
+                                const char *script, FILE *log);
+extern void PlayerInit(struct FramePlayer *player,
+                       const SynapticsParameters *para, CARD32 now,
+                       const struct GestureSink *out, void *out_data);
+extern Bool PlayerFeed(struct FramePlayer *player,
+                       unsigned int type, unsigned int code, int value,
+                       CARD32 millis);
+extern void PlayerFinish(struct FramePlayer *player, CARD32 limit);
+
+#endif                          /* _PLAYER_H_ */
@@ -61,34 +61,29 @@
 #define XI_PROP_DEVICE_NODE "Device Node"
 #endif
 
-static Atom float_type;
-
-Atom prop_finger = 0;
-Atom prop_tap_time = 0;
-Atom prop_tap_move = 0;
-Atom prop_clickpad = 0;
-Atom prop_scrolldist = 0;
-Atom prop_scrolltwofinger = 0;
-Atom prop_speed = 0;
-Atom prop_edgemotion_pressure = 0;
-Atom prop_edgemotion_speed = 0;
-Atom prop_edgemotion_always = 0;
-Atom prop_off = 0;
-Atom prop_pressuremotion = 0;
-Atom prop_pressuremotion_factor = 0;
-Atom prop_grab = 0;
-Atom prop_capabilities = 0;
-Atom prop_resolution = 0;
-Atom prop_noise_cancellation = 0;
-Atom prop_product_id = 0;
-Atom prop_device_node = 0;
-
-Atom prop_bottom_buttons = 0;
-Atom prop_top_buttons = 0;
-Atom prop_scroll_twofinger_finger_size = 0;
-Atom prop_tap_extras = 0;
+/* Upper bound for the monitor update rate */
+#define MONITOR_MIN_INTERVAL 10
 
 
+/* Store values in the property unless it already holds exactly them.
+ * Clients are told about a changed value, not about a new property. */
+static void
+UpdateProperty(DeviceIntPtr dev, Atom atom, Atom type, int format,
+               int nvalues, const void *values)
+{
+    XIPropertyValuePtr cur;
+    Bool exists;
+
+    exists = XIGetDeviceProperty(dev, atom, &cur) == Success;
+    if (exists && cur->type == type && cur->format == format &&
+        cur->size == nvalues &&
+        memcmp(cur->data, values, nvalues * format / 8) == 0)
+        return;
+
+    XIChangeDeviceProperty(dev, atom, type, format, PropModeReplace, nvalues,
+                           values, exists);
+}
+
 static Atom
 InitTypedAtom(DeviceIntPtr dev, char *name, Atom type, int format, int nvalues,
               int *values)
@@ -127,8 +122,7 @@ InitTypedAtom(DeviceIntPtr dev, char *name, Atom type, int format, int nvalues,
     }
 
     atom = MakeAtom(name, strlen(name), TRUE);
-    XIChangeDeviceProperty(dev, atom, type, format, PropModeReplace, nvalues,
-                           converted, FALSE);
+    UpdateProperty(dev, atom, type, format, nvalues, converted);
     XISetDevicePropertyDeletable(dev, atom, FALSE);
     return atom;
 }
@@ -142,177 +136,418 @@ InitAtom(DeviceIntPtr dev, char *name, int format, int nvalues, int *values)
 static Atom
 InitFloatAtom(DeviceIntPtr dev, char *name, int nvalues, float *values)
 {
+    InputInfoPtr pInfo = dev->public.devicePrivate;
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
     Atom atom;
 
     atom = MakeAtom(name, strlen(name), TRUE);
-    XIChangeDeviceProperty(dev, atom, float_type, 32, PropModeReplace,
-                           nvalues, values, FALSE);
+    UpdateProperty(dev, atom, priv->atoms.float_type, 32, nvalues, values);
     XISetDevicePropertyDeletable(dev, atom, FALSE);
     return atom;
 }
 
-void
-InitDeviceProperties(InputInfoPtr pInfo)
+/* Publish the tunable parameters. Called on init and whenever the parameters
+ * have been replaced as a whole, so the per-setting properties stay in sync;
+ * the ones that changed are announced with DevicePropertyNotify. */
+static void
+InitParameterProperties(InputInfoPtr pInfo)
 {
     SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
-    SynapticsParameters *para = &priv->synpara;
+    SynapticsParameters *para = priv->synpara;
     int values[9];              /* we never have more than 9 values in an atom */
     float fvalues[4];           /* never have more than 4 float values */
 
-    float_type = XIGetKnownProperty(XATOM_FLOAT);
-    if (!float_type) {
-        float_type = MakeAtom(XATOM_FLOAT, strlen(XATOM_FLOAT), TRUE);
-        if (!float_type) {
-            xf86IDrvMsg(pInfo, X_ERROR, "Failed to init float atom. "
-                        "Disabling property support.\n");
-            return;
-        }
-    }
-
     values[0] = para->finger_low;
     values[1] = para->finger_high;
     values[2] = 0;
 
-    prop_finger = InitAtom(pInfo->dev, SYNAPTICS_PROP_FINGER, 32, 3, values);
-    prop_tap_time =
+    priv->atoms.finger = InitAtom(pInfo->dev, SYNAPTICS_PROP_FINGER, 32, 3, values);
+    priv->atoms.tap_time =
         InitAtom(pInfo->dev, SYNAPTICS_PROP_TAP_TIME, 32, 1, &para->tap_time);
-    prop_tap_move =
+    priv->atoms.tap_move =
         InitAtom(pInfo->dev, SYNAPTICS_PROP_TAP_MOVE, 32, 1, &para->tap_move);
 
-    prop_clickpad =
+    priv->atoms.clickpad =
         InitAtom(pInfo->dev, SYNAPTICS_PROP_CLICKPAD, 8, 1, &para->clickpad);
 
     values[0] = para->scroll_dist_vert;
     values[1] = para->scroll_dist_horiz;
-    prop_scrolldist =
+    priv->atoms.scrolldist =
         InitAtom(pInfo->dev, SYNAPTICS_PROP_SCROLL_DISTANCE, 32, 2, values);
 
     values[0] = para->scroll_twofinger_vert;
     values[1] = para->scroll_twofinger_horiz;
-    prop_scrolltwofinger =
+    priv->atoms.scrolltwofinger =
         InitAtom(pInfo->dev, SYNAPTICS_PROP_SCROLL_TWOFINGER, 8, 2, values);
 
     fvalues[0] = para->min_speed;
     fvalues[1] = para->max_speed;
     fvalues[2] = para->accl;
     fvalues[3] = 0;
-    prop_speed = InitFloatAtom(pInfo->dev, SYNAPTICS_PROP_SPEED, 4, fvalues);
+    priv->atoms.speed = InitFloatAtom(pInfo->dev, SYNAPTICS_PROP_SPEED, 4, fvalues);
 
-    prop_off =
+    priv->atoms.off =
         InitAtom(pInfo->dev, SYNAPTICS_PROP_OFF, 8, 1, &para->touchpad_off);
 
     values[0] = para->press_motion_min_z;
     values[1] = para->press_motion_max_z;
-    prop_pressuremotion =
+    priv->atoms.pressuremotion =
         InitTypedAtom(pInfo->dev, SYNAPTICS_PROP_PRESSURE_MOTION, XA_CARDINAL,
                       32, 2, values);
 
     fvalues[0] = para->press_motion_min_factor;
     fvalues[1] = para->press_motion_max_factor;
 
-    prop_pressuremotion_factor =
+    priv->atoms.pressuremotion_factor =
         InitFloatAtom(pInfo->dev, SYNAPTICS_PROP_PRESSURE_MOTION_FACTOR, 2,
                       fvalues);
 
-    prop_grab =
+    priv->atoms.grab =
         InitAtom(pInfo->dev, SYNAPTICS_PROP_GRAB, 8, 1,
                  &para->grab_event_device);
 
-    // TODO: size???
-    values[0] = priv->has_left;
-    values[1] = FALSE; // priv->has_middle;
-    values[2] = FALSE; // priv->has_right;
-    values[3] = FALSE; // priv->has_double;
-    values[4] = FALSE; // priv->has_triple;
-    values[5] = priv->has_pressure;
-    values[6] = priv->has_width;
-    prop_capabilities =
-        InitAtom(pInfo->dev, SYNAPTICS_PROP_CAPABILITIES, 8, 7, values);
-
-    values[0] = para->resolution_vert;
-    values[1] = para->resolution_horiz;
-    prop_resolution =
-        InitAtom(pInfo->dev, SYNAPTICS_PROP_RESOLUTION, 32, 2, values);
-
     values[0] = para->hyst_x;
     values[1] = para->hyst_y;
-    prop_noise_cancellation = InitAtom(pInfo->dev,
+    priv->atoms.noise_cancellation = InitAtom(pInfo->dev,
                                        SYNAPTICS_PROP_NOISE_CANCELLATION, 32, 2,
                                        values);
 
     values[0] = para->bottom_buttons_height;
 	values[1] = para->bottom_buttons_sep_pos;
 	values[2] = para->bottom_buttons_sep_width;
-	prop_bottom_buttons = InitAtom(pInfo->dev,
+	priv->atoms.bottom_buttons = InitAtom(pInfo->dev,
                                        SYNAPTICS_PROP_BOTTOM_BUTTONS, 32, 3,
                                        values);
 
 	values[0] = para->top_buttons_height;
 	values[1] = para->top_buttons_middle_width;
-	prop_top_buttons = InitAtom(pInfo->dev,
+	priv->atoms.top_buttons = InitAtom(pInfo->dev,
                                        SYNAPTICS_PROP_TOP_BUTTONS, 32, 2,
                                        values);
 
-    prop_scroll_twofinger_finger_size =
+    priv->atoms.scroll_twofinger_finger_size =
         InitAtom(pInfo->dev, SYNAPTICS_PROP_SCROLL_TWOFINGER_FINGER_SIZE, 32, 1,
                  &para->scroll_twofinger_finger_size);
 
 	values[0] = para->tap_pressure;
 	values[1] = para->tap_anywhere;
 	values[2] = para->tap_hold;
-	prop_tap_extras = InitAtom(pInfo->dev,
+	priv->atoms.tap_extras = InitAtom(pInfo->dev,
                                        SYNAPTICS_PROP_TAP_EXTRAS, 32, 3,
                                        values);
 
+    priv->atoms.typing_timeout =
+        InitAtom(pInfo->dev, SYNAPTICS_PROP_TYPING_TIMEOUT, 32, 1,
+                 &para->typing_timeout);
+}
+
+static INT32
+float_to_pb(float f)
+{
+    union { float f; INT32 i; } u;
+
+    u.f = f;
+    return u.i;
+}
+
+static float
+pb_to_float(INT32 i)
+{
+    union { float f; INT32 i; } u;
+
+    u.i = i;
+    return u.f;
+}
+
+/* Pack the current parameters into the SYNAPTICS_PROP_PARAM_BLOCK layout */
+static void
+FillParameterBlock(const SynapticsParameters *para, INT32 *pb)
+{
+    pb[SYNAPTICS_PB_LAYOUT_VERSION] = SYNAPTICS_PB_VERSION;
+    pb[SYNAPTICS_PB_FINGER_LOW] = para->finger_low;
+    pb[SYNAPTICS_PB_FINGER_HIGH] = para->finger_high;
+    pb[SYNAPTICS_PB_TAP_TIME] = para->tap_time;
+    pb[SYNAPTICS_PB_TAP_MOVE] = para->tap_move;
+    pb[SYNAPTICS_PB_CLICKPAD] = para->clickpad;
+    pb[SYNAPTICS_PB_SCROLL_DIST_VERT] = para->scroll_dist_vert;
+    pb[SYNAPTICS_PB_SCROLL_DIST_HORIZ] = para->scroll_dist_horiz;
+    pb[SYNAPTICS_PB_SCROLL_TWOFINGER_VERT] = para->scroll_twofinger_vert;
+    pb[SYNAPTICS_PB_SCROLL_TWOFINGER_HORIZ] = para->scroll_twofinger_horiz;
+    pb[SYNAPTICS_PB_MIN_SPEED] = float_to_pb(para->min_speed);
+    pb[SYNAPTICS_PB_MAX_SPEED] = float_to_pb(para->max_speed);
+    pb[SYNAPTICS_PB_ACCEL_FACTOR] = float_to_pb(para->accl);
+    pb[SYNAPTICS_PB_OFF] = para->touchpad_off;
+    pb[SYNAPTICS_PB_PRESSURE_MOTION_MIN_Z] = para->press_motion_min_z;
+    pb[SYNAPTICS_PB_PRESSURE_MOTION_MAX_Z] = para->press_motion_max_z;
+    pb[SYNAPTICS_PB_PRESSURE_MOTION_MIN_FACTOR] =
+        float_to_pb(para->press_motion_min_factor);
+    pb[SYNAPTICS_PB_PRESSURE_MOTION_MAX_FACTOR] =
+        float_to_pb(para->press_motion_max_factor);
+    pb[SYNAPTICS_PB_GRAB] = para->grab_event_device;
+    pb[SYNAPTICS_PB_HYST_X] = para->hyst_x;
+    pb[SYNAPTICS_PB_HYST_Y] = para->hyst_y;
+    pb[SYNAPTICS_PB_BOTTOM_BUTTONS_HEIGHT] = para->bottom_buttons_height;
+    pb[SYNAPTICS_PB_BOTTOM_BUTTONS_SEP_POS] = para->bottom_buttons_sep_pos;
+    pb[SYNAPTICS_PB_BOTTOM_BUTTONS_SEP_WIDTH] = para->bottom_buttons_sep_width;
+    pb[SYNAPTICS_PB_TOP_BUTTONS_HEIGHT] = para->top_buttons_height;
+    pb[SYNAPTICS_PB_TOP_BUTTONS_MIDDLE_WIDTH] = para->top_buttons_middle_width;
+    pb[SYNAPTICS_PB_TWOFINGER_FINGER_SIZE] = para->scroll_twofinger_finger_size;
+    pb[SYNAPTICS_PB_TAP_PRESSURE] = para->tap_pressure;
+    pb[SYNAPTICS_PB_TAP_ANYWHERE] = para->tap_anywhere;
+    pb[SYNAPTICS_PB_TAP_HOLD] = para->tap_hold;
+    pb[SYNAPTICS_PB_TYPING_TIMEOUT] = para->typing_timeout;
+}
+
+static void
+InitParameterBlockProperty(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    INT32 pb[SYNAPTICS_PB_COUNT];
+
+    FillParameterBlock(priv->synpara, pb);
+
+    priv->atoms.param_block = MakeAtom(SYNAPTICS_PROP_PARAM_BLOCK,
+                                strlen(SYNAPTICS_PROP_PARAM_BLOCK), TRUE);
+    XIChangeDeviceProperty(pInfo->dev, priv->atoms.param_block, XA_INTEGER, 32,
+                           PropModeReplace, SYNAPTICS_PB_COUNT, pb, FALSE);
+    XISetDevicePropertyDeletable(pInfo->dev, priv->atoms.param_block, FALSE);
+}
+
+static void
+InitProfileProperties(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    char names[SYN_MAX_PROFILES * 64];
+    int active = priv->synpara - priv->profiles;
+    int i, len = 0;
+
+    for (i = 0; i < priv->num_profiles; i++) {
+        const char *name = priv->profile_names[i] ? priv->profile_names[i] : "";
+        int n = strlen(name) + 1;
+
+        if (len + n > sizeof(names))
+            break;
+        memcpy(names + len, name, n);
+        len += n;
+    }
+
+    priv->atoms.active_profile =
+        InitAtom(pInfo->dev, SYNAPTICS_PROP_ACTIVE_PROFILE, 32, 1, &active);
+
+    priv->atoms.profile_names = MakeAtom(SYNAPTICS_PROP_PROFILE_NAMES,
+                                  strlen(SYNAPTICS_PROP_PROFILE_NAMES), TRUE);
+    XIChangeDeviceProperty(pInfo->dev, priv->atoms.profile_names, XA_STRING, 8,
+                           PropModeReplace, len, names, FALSE);
+    XISetDevicePropertyDeletable(pInfo->dev, priv->atoms.profile_names, FALSE);
+}
+
+static void
+InitMonitorProperties(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    int values[2] = { 0, 0 };
+
+    priv->atoms.monitor_control =
+        InitAtom(pInfo->dev, SYNAPTICS_PROP_MONITOR_CONTROL, 32, 2, values);
+
+    priv->atoms.monitor_state = MakeAtom(SYNAPTICS_PROP_MONITOR_STATE,
+                                  strlen(SYNAPTICS_PROP_MONITOR_STATE), TRUE);
+    XIChangeDeviceProperty(pInfo->dev, priv->atoms.monitor_state, XA_INTEGER, 32,
+                           PropModeReplace, SYNAPTICS_MON_COUNT,
+                           priv->monitor.state, FALSE);
+    XISetDevicePropertyDeletable(pInfo->dev, priv->atoms.monitor_state, FALSE);
+}
+
+static void
+InitLatencyProperty(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+
+    priv->atoms.latency = MakeAtom(SYNAPTICS_PROP_LATENCY,
+                             strlen(SYNAPTICS_PROP_LATENCY), TRUE);
+    XIChangeDeviceProperty(pInfo->dev, priv->atoms.latency, XA_INTEGER, 32,
+                           PropModeReplace, SYNAPTICS_LAT_COUNT,
+                           priv->latency.hist, FALSE);
+    XISetDevicePropertyDeletable(pInfo->dev, priv->atoms.latency, FALSE);
+}
+
+static void
+InitCountersProperty(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+
+    priv->atoms.counters = MakeAtom(SYNAPTICS_PROP_COUNTERS,
+                              strlen(SYNAPTICS_PROP_COUNTERS), TRUE);
+    XIChangeDeviceProperty(pInfo->dev, priv->atoms.counters, XA_INTEGER, 32,
+                           PropModeReplace, SYNAPTICS_CNT_COUNT,
+                           priv->gs.counters, FALSE);
+    XISetDevicePropertyDeletable(pInfo->dev, priv->atoms.counters, FALSE);
+}
+
+/* Copy the last snapshot out of HandleState's reach and publish it. Clients
+ * selecting DevicePropertyNotify are told about every update. */
+static void
+PublishMonitorState(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    INT32 state[SYNAPTICS_MON_COUNT];
+    int sigstate;
+
+    sigstate = xf86BlockSIGIO();
+    memcpy(state, priv->monitor.state, sizeof(state));
+    priv->monitor.dirty = FALSE;
+    xf86UnblockSIGIO(sigstate);
+
+    priv->updating_properties = TRUE;
+    XIChangeDeviceProperty(pInfo->dev, priv->atoms.monitor_state, XA_INTEGER, 32,
+                           PropModeReplace, SYNAPTICS_MON_COUNT, state, TRUE);
+    priv->updating_properties = FALSE;
+}
+
+/* Cancel the monitor and tell the clients, also when the device is
+ * disabled. */
+void
+StopMonitor(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    INT32 values[2] = { 0, 0 };
+
+    priv->monitor.interval = 0;
+    TimerCancel(priv->monitor.timer);
+
+    priv->updating_properties = TRUE;
+    XIChangeDeviceProperty(pInfo->dev, priv->atoms.monitor_control, XA_INTEGER, 32,
+                           PropModeReplace, 2, values, TRUE);
+    priv->updating_properties = FALSE;
+}
+
+static CARD32
+MonitorTimerFunc(OsTimerPtr timer, CARD32 now, pointer arg)
+{
+    InputInfoPtr pInfo = arg;
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+
+    if ((INT32) (now - priv->monitor.expires) >= 0) {
+        StopMonitor(pInfo);
+        return 0;
+    }
+
+    if (priv->monitor.dirty)
+        PublishMonitorState(pInfo);
+
+    return priv->monitor.interval;
+}
+
+/* Make profile the active parameter set. Its derived values are kept up to
+ * date while it is inactive, so this only swaps the pointer and tells the
+ * server and clients about the new values. */
+static void
+SwitchProfile(InputInfoPtr pInfo, int profile)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    SynapticsParameters *old = priv->synpara;
+    SynapticsParameters *new = &priv->profiles[profile];
+
+    if (old == new)
+        return;
+
+    /* on/off is runtime state (syndaemon), not part of the tuning, and the
+     * grab only changes when the device is enabled again */
+    new->touchpad_off = old->touchpad_off;
+    new->grab_event_device = old->grab_event_device;
+    priv->synpara = new;
+
+    if (new->scroll_dist_vert != old->scroll_dist_vert)
+        SetScrollValuator(pInfo->dev, priv->scroll_axis_vert,
+                          SCROLL_TYPE_VERTICAL, new->scroll_dist_vert, 0);
+    if (new->scroll_dist_horiz != old->scroll_dist_horiz)
+        SetScrollValuator(pInfo->dev, priv->scroll_axis_horiz,
+                          SCROLL_TYPE_HORIZONTAL, new->scroll_dist_horiz, 0);
+
+    priv->updating_properties = TRUE;
+    InitParameterProperties(pInfo);
+    priv->updating_properties = FALSE;
+}
+
+void
+InitDeviceProperties(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    SynapticsParameters *para = priv->synpara;
+    int values[9];              /* we never have more than 9 values in an atom */
+
+    priv->atoms.float_type = XIGetKnownProperty(XATOM_FLOAT);
+    if (!priv->atoms.float_type) {
+        priv->atoms.float_type = MakeAtom(XATOM_FLOAT, strlen(XATOM_FLOAT), TRUE);
+        if (!priv->atoms.float_type) {
+            xf86IDrvMsg(pInfo, X_ERROR, "Failed to init float atom. "
+                        "Disabling property support.\n");
+            return;
+        }
+    }
+
+    InitParameterProperties(pInfo);
+    InitParameterBlockProperty(pInfo);
+    InitProfileProperties(pInfo);
+    InitMonitorProperties(pInfo);
+    InitLatencyProperty(pInfo);
+    InitCountersProperty(pInfo);
+
+    // TODO: size???
+    values[0] = priv->has_left;
+    values[1] = FALSE; // priv->has_middle;
+    values[2] = FALSE; // priv->has_right;
+    values[3] = FALSE; // priv->has_double;
+    values[4] = FALSE; // priv->has_triple;
+    values[5] = priv->has_pressure;
+    values[6] = priv->has_width;
+    priv->atoms.capabilities =
+        InitAtom(pInfo->dev, SYNAPTICS_PROP_CAPABILITIES, 8, 7, values);
+
+    values[0] = para->resolution_vert;
+    values[1] = para->resolution_horiz;
+    priv->atoms.resolution =
+        InitAtom(pInfo->dev, SYNAPTICS_PROP_RESOLUTION, 32, 2, values);
 
     /* only init product_id property if we actually know them */
     if (priv->id_vendor || priv->id_product) {
         values[0] = priv->id_vendor;
         values[1] = priv->id_product;
-        prop_product_id =
+        priv->atoms.product_id =
             InitAtom(pInfo->dev, XI_PROP_PRODUCT_ID, 32, 2, values);
     }
 
     if (priv->device) {
-        prop_device_node =
+        priv->atoms.device_node =
             MakeAtom(XI_PROP_DEVICE_NODE, strlen(XI_PROP_DEVICE_NODE), TRUE);
-        XIChangeDeviceProperty(pInfo->dev, prop_device_node, XA_STRING, 8,
+        XIChangeDeviceProperty(pInfo->dev, priv->atoms.device_node, XA_STRING, 8,
                                PropModeReplace, strlen(priv->device),
                                (pointer) priv->device, FALSE);
-        XISetDevicePropertyDeletable(pInfo->dev, prop_device_node, FALSE);
+        XISetDevicePropertyDeletable(pInfo->dev, priv->atoms.device_node, FALSE);
     }
 
 }
-void SetCoordsFromPercent(InputInfoPtr pInfo, int flag){
-    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
-    SynapticsParameters *pars = &priv->synpara;
-
-    int width = abs(priv->maxx - priv->minx);
-    int height = abs(priv->maxy - priv->miny);
-
-	if(!flag || flag==1){
-		pars->no_button_max_y=(100-pars->bottom_buttons_height)/100.0 * height + priv->miny;
-		pars->bottom_left_btn_rx=(pars->bottom_buttons_sep_pos-pars->bottom_buttons_sep_width/2) / 100.0 * width + priv->minx;
-		pars->bottom_right_btn_lx=(pars->bottom_buttons_sep_pos+pars->bottom_buttons_sep_width/2) / 100.0 * width + priv->minx;
-	}
-	if(!flag || flag==2){
-		pars->no_button_min_y=pars->top_buttons_height/100.0 * height + priv->miny;
-		pars->top_mid_lx=(50-pars->top_buttons_middle_width/2) / 100.0 * width + priv->minx;
-		pars->top_mid_rx=(50+pars->top_buttons_middle_width/2) / 100.0 * width + priv->minx;
-	}
-	if(!flag || flag==3) pars->finger_radius=pars->scroll_twofinger_finger_size/100.0 * width;
+void
+UpdateDerivedParameters(SynapticsPrivate *priv, SynapticsParameters *pars,
+                        unsigned int dirty)
+{
+    GestureUpdateDerivedParameters(pars, priv->minx, priv->maxx,
+                                   priv->miny, priv->maxy, dirty);
 }
 
-
 int
 SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
             BOOL checkonly)
 {
     InputInfoPtr pInfo = dev->public.devicePrivate;
     SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
-    SynapticsParameters *para = &priv->synpara;
+    SynapticsParameters *para = priv->synpara;
     SynapticsParameters tmp;
+    unsigned int dirty = 0;     /* raw inputs of derived parameters changed */
 
+    /* The driver is re-publishing values that are already in effect */
+    if (priv->updating_properties)
+        return Success;
 
     /* If checkonly is set, no parameters may be changed. So just let the code
      * change temporary variables and forget about it. */
@@ -321,7 +556,7 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
         para = &tmp;
     }
 
-    if (property == prop_finger) {
+    if (property == priv->atoms.finger) {
         INT32 *finger;
 
         if (prop->size != 3 || prop->format != 32 || prop->type != XA_INTEGER)
@@ -335,7 +570,7 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
         para->finger_high = finger[1];
     }
 
-    else if (property == prop_tap_extras) {
+    else if (property == priv->atoms.tap_extras) {
         INT32 *tapextras;
 
         if (prop->size != 3 || prop->format != 32 || prop->type != XA_INTEGER)
@@ -350,16 +585,28 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
 		para->tap_hold = tapextras[2];
 
     }
-    else if (property == prop_scroll_twofinger_finger_size) {
+    else if (property == priv->atoms.typing_timeout) {
+        INT32 timeout;
 
         if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
             return BadMatch;
 
-        para->scroll_twofinger_finger_size = *(INT32 *) prop->data;
+        timeout = *(INT32 *) prop->data;
+        if (timeout < 0)
+            return BadValue;
 
-		SetCoordsFromPercent(pInfo,3);
+        para->typing_timeout = timeout;
     }
-    else if (property == prop_top_buttons) {
+    else if (property == priv->atoms.scroll_twofinger_finger_size) {
+
+        if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
+            return BadMatch;
+
+        if (para->scroll_twofinger_finger_size != *(INT32 *) prop->data)
+            dirty |= PD_FINGER_SIZE;
+        para->scroll_twofinger_finger_size = *(INT32 *) prop->data;
+    }
+    else if (property == priv->atoms.top_buttons) {
         INT32 *tbtns;
 
         if (prop->size != 2 || prop->format != 32 || prop->type != XA_INTEGER)
@@ -367,13 +614,14 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
 
         tbtns = (INT32 *) prop->data;
 
+        if (para->top_buttons_height != tbtns[0] ||
+            para->top_buttons_middle_width != tbtns[1])
+            dirty |= PD_TOP_BUTTONS;
+
 		para->top_buttons_height = tbtns[0];
 		para->top_buttons_middle_width = tbtns[1];
-
-		SetCoordsFromPercent(pInfo,2);
-
     }
-    else if (property == prop_bottom_buttons) {
+    else if (property == priv->atoms.bottom_buttons) {
         INT32 *bbtns;
 
         if (prop->size != 3 || prop->format != 32 || prop->type != XA_INTEGER)
@@ -381,27 +629,29 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
 
         bbtns = (INT32 *) prop->data;
 
+        if (para->bottom_buttons_height != bbtns[0] ||
+            para->bottom_buttons_sep_pos != bbtns[1] ||
+            para->bottom_buttons_sep_width != bbtns[2])
+            dirty |= PD_BOTTOM_BUTTONS;
+
 		para->bottom_buttons_height = bbtns[0];
 		para->bottom_buttons_sep_pos = bbtns[1];
 		para->bottom_buttons_sep_width = bbtns[2];
-
-		SetCoordsFromPercent(pInfo,1);
-
     }
-    else if (property == prop_tap_time) {
+    else if (property == priv->atoms.tap_time) {
         if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
             return BadMatch;
 
         para->tap_time = *(INT32 *) prop->data;
 
     }
-    else if (property == prop_tap_move) {
+    else if (property == priv->atoms.tap_move) {
         if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
             return BadMatch;
 
         para->tap_move = *(INT32 *) prop->data;
     }
-    else if (property == prop_clickpad) {
+    else if (property == priv->atoms.clickpad) {
         BOOL value;
 
         if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
@@ -417,7 +667,7 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
 
         para->clickpad = *(BOOL *) prop->data;
     }
-    else if (property == prop_scrolldist) {
+    else if (property == priv->atoms.scrolldist) {
         INT32 *dist;
 
         if (prop->size != 2 || prop->format != 32 || prop->type != XA_INTEGER)
@@ -439,7 +689,7 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
                               0);
         }
     }
-    else if (property == prop_scrolltwofinger) {
+    else if (property == priv->atoms.scrolltwofinger) {
         CARD8 *twofinger;
 
         if (prop->size != 2 || prop->format != 8 || prop->type != XA_INTEGER)
@@ -449,10 +699,10 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
         para->scroll_twofinger_vert = twofinger[0];
         para->scroll_twofinger_horiz = twofinger[1];
     }
-    else if (property == prop_speed) {
+    else if (property == priv->atoms.speed) {
         float *speed;
 
-        if (prop->size != 4 || prop->format != 32 || prop->type != float_type)
+        if (prop->size != 4 || prop->format != 32 || prop->type != priv->atoms.float_type)
             return BadMatch;
 
         speed = (float *) prop->data;
@@ -460,7 +710,7 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
         para->max_speed = speed[1];
         para->accl = speed[2];
     }
-    else if (property == prop_off) {
+    else if (property == priv->atoms.off) {
         CARD8 off;
 
         if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
@@ -473,7 +723,7 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
 
         para->touchpad_off = off;
     }
-    else if (property == prop_pressuremotion) {
+    else if (property == priv->atoms.pressuremotion) {
         CARD32 *press;
 
         if (prop->size != 2 || prop->format != 32 || prop->type != XA_CARDINAL)
@@ -486,10 +736,10 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
         para->press_motion_min_z = press[0];
         para->press_motion_max_z = press[1];
     }
-    else if (property == prop_pressuremotion_factor) {
+    else if (property == priv->atoms.pressuremotion_factor) {
         float *press;
 
-        if (prop->size != 2 || prop->format != 32 || prop->type != float_type)
+        if (prop->size != 2 || prop->format != 32 || prop->type != priv->atoms.float_type)
             return BadMatch;
 
         press = (float *) prop->data;
@@ -499,21 +749,21 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
         para->press_motion_min_factor = press[0];
         para->press_motion_max_factor = press[1];
     }
-    else if (property == prop_grab) {
+    else if (property == priv->atoms.grab) {
         if (prop->size != 1 || prop->format != 8 || prop->type != XA_INTEGER)
             return BadMatch;
 
         para->grab_event_device = *(BOOL *) prop->data;
     }
-    else if (property == prop_capabilities) {
+    else if (property == priv->atoms.capabilities) {
         /* read-only */
         return BadValue;
     }
-    else if (property == prop_resolution) {
+    else if (property == priv->atoms.resolution) {
         /* read-only */
         return BadValue;
     }
-    else if (property == prop_noise_cancellation) {
+    else if (property == priv->atoms.noise_cancellation) {
         INT32 *hyst;
 
         if (prop->size != 2 || prop->format != 32 || prop->type != XA_INTEGER)
@@ -525,8 +775,212 @@ SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
         para->hyst_x = hyst[0];
         para->hyst_y = hyst[1];
     }
-    else if (property == prop_product_id || property == prop_device_node)
+    else if (property == priv->atoms.param_block) {
+        INT32 *pb;
+        int old_dist_vert = para->scroll_dist_vert;
+        int old_dist_horiz = para->scroll_dist_horiz;
+
+        if (prop->size != SYNAPTICS_PB_COUNT || prop->format != 32 ||
+            prop->type != XA_INTEGER)
+            return BadMatch;
+
+        pb = (INT32 *) prop->data;
+        if (pb[SYNAPTICS_PB_LAYOUT_VERSION] != SYNAPTICS_PB_VERSION)
+            return BadMatch;
+
+        /* validate everything before touching anything */
+        if (pb[SYNAPTICS_PB_FINGER_LOW] > pb[SYNAPTICS_PB_FINGER_HIGH] ||
+            pb[SYNAPTICS_PB_SCROLL_DIST_VERT] == 0 ||
+            pb[SYNAPTICS_PB_SCROLL_DIST_HORIZ] == 0 ||
+            (CARD32) pb[SYNAPTICS_PB_PRESSURE_MOTION_MIN_Z] >
+            (CARD32) pb[SYNAPTICS_PB_PRESSURE_MOTION_MAX_Z] ||
+            pb_to_float(pb[SYNAPTICS_PB_PRESSURE_MOTION_MIN_FACTOR]) >
+            pb_to_float(pb[SYNAPTICS_PB_PRESSURE_MOTION_MAX_FACTOR]) ||
+            pb[SYNAPTICS_PB_HYST_X] < 0 || pb[SYNAPTICS_PB_HYST_Y] < 0 ||
+            pb[SYNAPTICS_PB_TAP_ANYWHERE] > 2 ||
+            pb[SYNAPTICS_PB_TYPING_TIMEOUT] < 0)
+            return BadValue;
+
+        if (para->bottom_buttons_height != pb[SYNAPTICS_PB_BOTTOM_BUTTONS_HEIGHT] ||
+            para->bottom_buttons_sep_pos != pb[SYNAPTICS_PB_BOTTOM_BUTTONS_SEP_POS] ||
+            para->bottom_buttons_sep_width != pb[SYNAPTICS_PB_BOTTOM_BUTTONS_SEP_WIDTH])
+            dirty |= PD_BOTTOM_BUTTONS;
+        if (para->top_buttons_height != pb[SYNAPTICS_PB_TOP_BUTTONS_HEIGHT] ||
+            para->top_buttons_middle_width != pb[SYNAPTICS_PB_TOP_BUTTONS_MIDDLE_WIDTH])
+            dirty |= PD_TOP_BUTTONS;
+        if (para->scroll_twofinger_finger_size != pb[SYNAPTICS_PB_TWOFINGER_FINGER_SIZE])
+            dirty |= PD_FINGER_SIZE;
+
+        para->finger_low = pb[SYNAPTICS_PB_FINGER_LOW];
+        para->finger_high = pb[SYNAPTICS_PB_FINGER_HIGH];
+        para->tap_time = pb[SYNAPTICS_PB_TAP_TIME];
+        para->tap_move = pb[SYNAPTICS_PB_TAP_MOVE];
+        para->clickpad = pb[SYNAPTICS_PB_CLICKPAD] != 0;
+        para->scroll_dist_vert = pb[SYNAPTICS_PB_SCROLL_DIST_VERT];
+        para->scroll_dist_horiz = pb[SYNAPTICS_PB_SCROLL_DIST_HORIZ];
+        para->scroll_twofinger_vert = pb[SYNAPTICS_PB_SCROLL_TWOFINGER_VERT] != 0;
+        para->scroll_twofinger_horiz = pb[SYNAPTICS_PB_SCROLL_TWOFINGER_HORIZ] != 0;
+        para->min_speed = pb_to_float(pb[SYNAPTICS_PB_MIN_SPEED]);
+        para->max_speed = pb_to_float(pb[SYNAPTICS_PB_MAX_SPEED]);
+        para->accl = pb_to_float(pb[SYNAPTICS_PB_ACCEL_FACTOR]);
+        /* SYNAPTICS_PB_OFF is ignored, on/off is runtime state (syndaemon) */
+        para->press_motion_min_z = pb[SYNAPTICS_PB_PRESSURE_MOTION_MIN_Z];
+        para->press_motion_max_z = pb[SYNAPTICS_PB_PRESSURE_MOTION_MAX_Z];
+        para->press_motion_min_factor =
+            pb_to_float(pb[SYNAPTICS_PB_PRESSURE_MOTION_MIN_FACTOR]);
+        para->press_motion_max_factor =
+            pb_to_float(pb[SYNAPTICS_PB_PRESSURE_MOTION_MAX_FACTOR]);
+        para->grab_event_device = pb[SYNAPTICS_PB_GRAB] != 0;
+        para->hyst_x = pb[SYNAPTICS_PB_HYST_X];
+        para->hyst_y = pb[SYNAPTICS_PB_HYST_Y];
+        para->bottom_buttons_height = pb[SYNAPTICS_PB_BOTTOM_BUTTONS_HEIGHT];
+        para->bottom_buttons_sep_pos = pb[SYNAPTICS_PB_BOTTOM_BUTTONS_SEP_POS];
+        para->bottom_buttons_sep_width = pb[SYNAPTICS_PB_BOTTOM_BUTTONS_SEP_WIDTH];
+        para->top_buttons_height = pb[SYNAPTICS_PB_TOP_BUTTONS_HEIGHT];
+        para->top_buttons_middle_width = pb[SYNAPTICS_PB_TOP_BUTTONS_MIDDLE_WIDTH];
+        para->scroll_twofinger_finger_size = pb[SYNAPTICS_PB_TWOFINGER_FINGER_SIZE];
+        para->tap_pressure = pb[SYNAPTICS_PB_TAP_PRESSURE];
+        para->tap_anywhere = pb[SYNAPTICS_PB_TAP_ANYWHERE];
+        para->tap_hold = pb[SYNAPTICS_PB_TAP_HOLD];
+        para->typing_timeout = pb[SYNAPTICS_PB_TYPING_TIMEOUT];
+
+        if (!checkonly) {
+            if (para->scroll_dist_vert != old_dist_vert)
+                SetScrollValuator(dev, priv->scroll_axis_vert,
+                                  SCROLL_TYPE_VERTICAL, para->scroll_dist_vert,
+                                  0);
+            if (para->scroll_dist_horiz != old_dist_horiz)
+                SetScrollValuator(dev, priv->scroll_axis_horiz,
+                                  SCROLL_TYPE_HORIZONTAL,
+                                  para->scroll_dist_horiz, 0);
+
+            priv->updating_properties = TRUE;
+            InitParameterProperties(pInfo);
+            priv->updating_properties = FALSE;
+        }
+    }
+    else if (property == priv->atoms.active_profile) {
+        INT32 profile;
+
+        if (prop->size != 1 || prop->format != 32 || prop->type != XA_INTEGER)
+            return BadMatch;
+
+        profile = *(INT32 *) prop->data;
+        if (profile < 0 || profile >= priv->num_profiles)
+            return BadValue;
+
+        if (!checkonly) {
+            SwitchProfile(pInfo, profile);
+            return Success;
+        }
+    }
+    else if (property == priv->atoms.profile_names)
         return BadValue;        /* read-only */
+    else if (property == priv->atoms.monitor_control) {
+        INT32 *ctl;
+
+        if (prop->size != 2 || prop->format != 32 || prop->type != XA_INTEGER)
+            return BadMatch;
+
+        ctl = (INT32 *) prop->data;
+        if (ctl[0] < 0 || ctl[1] < 0)
+            return BadValue;
+
+        if (!checkonly) {
+            if (!ctl[0] || !ctl[1]) {
+                priv->monitor.interval = 0;
+                TimerCancel(priv->monitor.timer);
+            }
+            else {
+                priv->monitor.interval = ctl[0] < MONITOR_MIN_INTERVAL ?
+                    MONITOR_MIN_INTERVAL : ctl[0];
+                priv->monitor.expires = GetTimeInMillis() + ctl[1];
+                priv->monitor.timer = TimerSet(priv->monitor.timer, 0,
+                                               priv->monitor.interval,
+                                               MonitorTimerFunc, pInfo);
+            }
+        }
+    }
+    else if (property == priv->atoms.monitor_state)
+        return BadValue;        /* read-only */
+    else if (property == priv->atoms.latency) {
+        int sigstate;
+
+        /* read-only, a write resets it and GetProperty puts the counts
+           back in place of the written values */
+        if (!checkonly) {
+            sigstate = xf86BlockSIGIO();
+            memset(priv->latency.hist, 0, sizeof(priv->latency.hist));
+            xf86UnblockSIGIO(sigstate);
+        }
+    }
+    else if (property == priv->atoms.counters) {
+        int sigstate;
+
+        /* read-only, like the latency histogram a write resets it */
+        if (!checkonly) {
+            sigstate = xf86BlockSIGIO();
+            memset(priv->gs.counters, 0, sizeof(priv->gs.counters));
+            xf86UnblockSIGIO(sigstate);
+        }
+    }
+    else if (property == priv->atoms.product_id || property == priv->atoms.device_node)
+        return BadValue;        /* read-only */
+
+    if (!checkonly)
+        UpdateDerivedParameters(priv, para, dirty);
+
+    return Success;
+}
+
+/* The parameter block mirrors the per-setting properties, refresh it
+ * before a client reads it. The same goes for a pending monitor update, the
+ * latency histogram and the counters. */
+int
+GetProperty(DeviceIntPtr dev, Atom property)
+{
+    InputInfoPtr pInfo = dev->public.devicePrivate;
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+
+    if (property == priv->atoms.param_block) {
+        INT32 pb[SYNAPTICS_PB_COUNT];
+
+        FillParameterBlock(priv->synpara, pb);
+
+        priv->updating_properties = TRUE;
+        XIChangeDeviceProperty(dev, priv->atoms.param_block, XA_INTEGER, 32,
+                               PropModeReplace, SYNAPTICS_PB_COUNT, pb, FALSE);
+        priv->updating_properties = FALSE;
+    }
+    else if (property == priv->atoms.monitor_state && priv->monitor.dirty)
+        PublishMonitorState(pInfo);
+    else if (property == priv->atoms.latency) {
+        CARD32 hist[SYNAPTICS_LAT_COUNT];
+        int sigstate;
+
+        sigstate = xf86BlockSIGIO();
+        memcpy(hist, priv->latency.hist, sizeof(hist));
+        xf86UnblockSIGIO(sigstate);
+
+        priv->updating_properties = TRUE;
+        XIChangeDeviceProperty(dev, priv->atoms.latency, XA_INTEGER, 32,
+                               PropModeReplace, SYNAPTICS_LAT_COUNT, hist, FALSE);
+        priv->updating_properties = FALSE;
+    }
+    else if (property == priv->atoms.counters) {
+        CARD32 counters[SYNAPTICS_CNT_COUNT];
+        int sigstate;
+
+        sigstate = xf86BlockSIGIO();
+        memcpy(counters, priv->gs.counters, sizeof(counters));
+        xf86UnblockSIGIO(sigstate);
+
+        priv->updating_properties = TRUE;
+        XIChangeDeviceProperty(dev, priv->atoms.counters, XA_INTEGER, 32,
+                               PropModeReplace, SYNAPTICS_CNT_COUNT, counters,
+                               FALSE);
+        priv->updating_properties = FALSE;
+    }
 
     return Success;
 }
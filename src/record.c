@@ -0,0 +1,163 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <linux/input.h>
+#include "record.h"
+
+#ifndef INPUT_PROP_BUTTONPAD
+#define INPUT_PROP_BUTTONPAD 0x02
+#endif
+#ifndef INPUT_PROP_SEMI_MT
+#define INPUT_PROP_SEMI_MT 0x03
+#endif
+
+/**
+ * Map the recording open on fd and check its header. The mapping stays
+ * valid after fd is closed.
+ *
+ * @return Zero on success, EINVAL if the file isn't a recording this code
+ * understands, or errno otherwise.
+ */
+int
+RecordMap(struct SynapticsRecord *rec, int fd)
+{
+    const struct SynapticsRecordHeader *header;
+    struct stat st;
+    void *map;
+
+    memset(rec, 0, sizeof(*rec));
+
+    if (fstat(fd, &st) == -1)
+        return errno;
+    if (!S_ISREG(st.st_mode) ||
+        st.st_size < sizeof(struct SynapticsRecordHeader))
+        return EINVAL;
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        return errno;
+
+    header = map;
+    if (header->magic != SYNAPTICS_RECORD_MAGIC ||
+        header->version < SYNAPTICS_RECORD_VERSION ||
+        header->event_size != sizeof(struct SynapticsRecordEvent) ||
+        header->header_size < sizeof(struct SynapticsRecordHeader) ||
+        header->header_size > st.st_size ||
+        header->header_size % sizeof(uint32_t)) {
+        munmap(map, st.st_size);
+        return EINVAL;
+    }
+
+    /* records are read sequentially, tell the kernel to read ahead */
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    rec->header = header;
+    rec->records = (const struct SynapticsRecordEvent *)
+        ((const char *) map + header->header_size);
+    rec->num_records = (st.st_size - header->header_size) /
+        sizeof(struct SynapticsRecordEvent);
+    rec->map = map;
+    rec->map_size = st.st_size;
+
+    return 0;
+}
+
+void
+RecordUnmap(struct SynapticsRecord *rec)
+{
+    if (rec->map)
+        munmap(rec->map, rec->map_size);
+    memset(rec, 0, sizeof(*rec));
+}
+
+/**
+ * Get the absinfo of the recorded device for the given ABS_FOO code.
+ * Behaves like event_get_abs(): a zero fuzz is ignored, fuzz and res may be
+ * NULL.
+ *
+ * @return TRUE if the device has the axis, FALSE otherwise (the outputs
+ * are left alone then).
+ */
+Bool
+RecordGetAbs(const struct SynapticsRecord *rec, int code,
+             int *min, int *max, int *fuzz, int *res)
+{
+    const struct SynapticsRecordAbs *abs;
+
+    if (code < 0 || code >= SYNAPTICS_RECORD_ABS_CNT ||
+        !SYNAPTICS_RECORD_TEST_BIT(rec->header->abs_bits, code))
+        return FALSE;
+
+    abs = &rec->header->abs[code];
+    *min = abs->minimum;
+    *max = abs->maximum;
+    if (fuzz && abs->fuzz > 0)
+        *fuzz = abs->fuzz;
+    if (res)
+        *res = abs->resolution;
+
+    return TRUE;
+}
+
+/**
+ * Describe the recorded device the way the event backend probes a live
+ * one: axis ranges from the MT axes if touches are tracked, from ABS_X/Y
+ * otherwise.
+ */
+void
+RecordGetDevice(const struct SynapticsRecord *rec, struct RecordDevice *dev)
+{
+    const struct SynapticsRecordHeader *header = rec->header;
+
+    memset(dev, 0, sizeof(*dev));
+    dev->hyst_x = -1;
+    dev->hyst_y = -1;
+
+    RecordGetAbs(rec, ABS_X, &dev->minx, &dev->maxx, &dev->hyst_x, &dev->resx);
+    RecordGetAbs(rec, ABS_Y, &dev->miny, &dev->maxy, &dev->hyst_y, &dev->resy);
+    dev->has_pressure = RecordGetAbs(rec, ABS_PRESSURE,
+                                     &dev->minp, &dev->maxp, NULL, NULL);
+    dev->has_width = RecordGetAbs(rec, ABS_TOOL_WIDTH,
+                                  &dev->minw, &dev->maxw, NULL, NULL);
+
+    dev->semi_mt = (header->props >> INPUT_PROP_SEMI_MT) & 1;
+    dev->clickpad = (header->props >> INPUT_PROP_BUTTONPAD) & 1;
+
+    if (header->num_slots && !dev->semi_mt &&
+        RecordGetAbs(rec, ABS_MT_POSITION_X, &dev->minx, &dev->maxx,
+                     &dev->hyst_x, &dev->resx) &&
+        RecordGetAbs(rec, ABS_MT_POSITION_Y, &dev->miny, &dev->maxy,
+                     &dev->hyst_y, &dev->resy))
+        dev->max_touches = header->num_slots;
+
+    dev->has_left = SYNAPTICS_RECORD_TEST_BIT(header->key_bits, BTN_LEFT);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _RECORD_H_
+#define _RECORD_H_
+
+/*
+ * Read access to touchpad recordings, see synaptics-record.h. The file is
+ * mapped and the records are used in place, a RecordCursor walks them and
+ * keeps track of the time. Doesn't depend on the X server.
+ */
+
+#include <stddef.h>
+#include <X11/Xdefs.h>
+#include <X11/Xmd.h>
+#include "synaptics-record.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+struct SynapticsRecord {
+    const struct SynapticsRecordHeader *header;
+    const struct SynapticsRecordEvent *records;    /* events and times */
+    size_t num_records;
+
+    void *map;
+    size_t map_size;
+};
+
+/* Position in a recording, see RecordRewind() */
+struct RecordCursor {
+    size_t next;                /* record to read next */
+    CARD32 millis;              /* time of the events from here on */
+};
+
+/* The device as the driver sees it, see RecordGetDevice() */
+struct RecordDevice {
+    int minx, maxx, miny, maxy;
+    int resx, resy;
+    int hyst_x, hyst_y;         /* axis fuzz, -1 if none */
+    Bool has_pressure;
+    int minp, maxp;
+    Bool has_width;
+    int minw, maxw;
+    Bool has_left;
+    Bool clickpad;
+    Bool semi_mt;
+    int max_touches;            /* 0 if touches aren't tracked */
+};
+
+extern int RecordMap(struct SynapticsRecord *rec, int fd);
+extern void RecordUnmap(struct SynapticsRecord *rec);
+extern Bool RecordGetAbs(const struct SynapticsRecord *rec, int code,
+                         int *min, int *max, int *fuzz, int *res);
+extern void RecordGetDevice(const struct SynapticsRecord *rec,
+                            struct RecordDevice *dev);
+
+/**
+ * Start reading rec from its first event, cur->millis is its time.
+ */
+static inline void
+RecordRewind(const struct SynapticsRecord *rec, struct RecordCursor *cur)
+{
+    size_t i;
+
+    cur->next = 0;
+    cur->millis = 0;
+    for (i = 0; i < rec->num_records; i++)
+        if (rec->records[i].type == SYNAPTICS_RECORD_TIME) {
+            cur->millis = (uint32_t) rec->records[i].value;
+            break;
+        }
+}
+
+/**
+ * Read the next event, cur->millis becomes its time.
+ *
+ * @return The event, NULL at the end of the recording.
+ */
+static inline const struct SynapticsRecordEvent *
+RecordNext(const struct SynapticsRecord *rec, struct RecordCursor *cur)
+{
+    while (cur->next < rec->num_records) {
+        const struct SynapticsRecordEvent *ev = &rec->records[cur->next++];
+
+        if (ev->type != SYNAPTICS_RECORD_TIME)
+            return ev;
+        cur->millis = (uint32_t) ev->value;
+    }
+
+    return NULL;
+}
+
+#endif                          /* _RECORD_H_ */
@@ -0,0 +1,336 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * The "replay" protocol: feeds the driver from a touchpad recording (see
+ * synaptics-record.h) instead of a device, e.g.
+ *
+ *   Option "Protocol" "replay"
+ *   Option "Device" "/path/to/recording"
+ *
+ * Events are delivered at their recorded pace, relative to the time the
+ * device is enabled, and go through the same frame decoding, gesture
+ * engine and posting code as the event backend. Once the recording is
+ * exhausted the device stays idle, disabling and enabling it starts over.
+ *
+ * The server reads from a pipe instead of the recording, a server timer
+ * writes to it when the next event is due. Unlike a regular file or a
+ * timerfd the pipe does SIGIO, so this works with and without the input
+ * thread.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <xorg-server.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/input.h>
+#include "synproto.h"
+#include "synapticsstr.h"
+#include "evframe.h"
+#include "record.h"
+#include <xf86.h>
+
+#define SYSCALL(call) while (((call) == -1) && (errno == EINTR))
+
+/**
+ * Protocol-specific data.
+ */
+struct replay_proto_data {
+    Bool valid;                 /* ReadDevDimensions found a recording */
+    struct SynapticsRecord rec; /* mapped while the device is on */
+    struct RecordCursor cur;    /* next event to deliver */
+    int cur_slot;
+
+    OsTimerPtr timer;           /* wakes the server for the next event */
+    int wake_fd;                /* write end of the pipe in pInfo->fd */
+
+    Bool started;               /* replay clock is running */
+    CARD32 start;               /* server time the replay started at */
+    CARD32 first;               /* recorded time of the first event */
+    Bool finished;
+};
+
+static void
+replay_wake(struct replay_proto_data *proto_data)
+{
+    int rc;
+
+    /* a full pipe is as good, the reader drains it */
+    SYSCALL(rc = write(proto_data->wake_fd, "", 1));
+}
+
+static CARD32
+replay_timer(OsTimerPtr timer, CARD32 now, pointer arg)
+{
+    replay_wake(arg);
+
+    return 0;
+}
+
+/**
+ * Make the device fd readable in millis ms.
+ */
+static void
+replay_arm(struct replay_proto_data *proto_data, CARD32 millis)
+{
+    if (millis)
+        proto_data->timer = TimerSet(proto_data->timer, 0, millis,
+                                     replay_timer, proto_data);
+    else
+        replay_wake(proto_data);
+}
+
+/**
+ * Map the recording and swap the file for the read end of a pipe, a
+ * regular file is always readable and would have the server call us in a
+ * loop. The timer is armed for the next event whenever ReadHwState runs
+ * out of due ones.
+ */
+static Bool
+ReplayDeviceOnHook(InputInfoPtr pInfo, SynapticsParameters * para)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    struct replay_proto_data *proto_data = priv->proto_data;
+    int rc, i, fds[2];
+
+    if (pInfo->flags & XI86_SERVER_FD) {
+        xf86IDrvMsg(pInfo, X_ERROR, "can't replay from a server managed fd\n");
+        return FALSE;
+    }
+
+    rc = RecordMap(&proto_data->rec, pInfo->fd);
+    if (rc) {
+        xf86IDrvMsg(pInfo, X_ERROR, "can't map recording: %s\n", strerror(rc));
+        return FALSE;
+    }
+
+    /* allocate now so we don't allocate in the signal handler */
+    proto_data->timer = TimerSet(NULL, 0, 0, NULL, NULL);
+    if (!proto_data->timer || pipe(fds) == -1) {
+        xf86IDrvMsg(pInfo, X_ERROR, "can't set up the replay timer\n");
+        TimerFree(proto_data->timer);
+        proto_data->timer = NULL;
+        RecordUnmap(&proto_data->rec);
+        return FALSE;
+    }
+
+    for (i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+
+    xf86CloseSerial(pInfo->fd);
+    pInfo->fd = fds[0];
+    proto_data->wake_fd = fds[1];
+
+    RecordRewind(&proto_data->rec, &proto_data->cur);
+    proto_data->cur_slot = 0;
+    proto_data->started = FALSE;
+    proto_data->finished = FALSE;
+
+    return TRUE;
+}
+
+static Bool
+ReplayDeviceOffHook(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    struct replay_proto_data *proto_data = priv->proto_data;
+
+    if (proto_data && proto_data->timer) {
+        TimerFree(proto_data->timer);
+        proto_data->timer = NULL;
+        close(proto_data->wake_fd);
+        RecordUnmap(&proto_data->rec);
+        proto_data->started = FALSE;
+    }
+
+    return Success;
+}
+
+/**
+ * There's no hardware to query. DeviceOn calls this after flushing the
+ * input, so a mapped recording starts playing here, a wake-up before
+ * the flush would have been lost.
+ */
+static Bool
+ReplayQueryHardware(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    struct replay_proto_data *proto_data = priv->proto_data;
+
+    if (!proto_data || !proto_data->valid)
+        return FALSE;
+
+    if (proto_data->rec.map && !proto_data->started) {
+        proto_data->start = priv->clock->now(priv->clock);
+        proto_data->first = proto_data->cur.millis;
+        proto_data->started = TRUE;
+        replay_arm(proto_data, 0);
+
+        xf86IDrvMsg(pInfo, X_INFO, "replaying %lu records\n",
+                    (unsigned long) proto_data->rec.num_records);
+    } else
+        xf86IDrvMsg(pInfo, X_PROBED, "touchpad recording found\n");
+
+    return TRUE;
+}
+
+static Bool
+ReplayReadHwState(InputInfoPtr pInfo,
+                  struct CommData *comm, struct SynapticsHwState *hwRet)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    struct replay_proto_data *proto_data = priv->proto_data;
+    struct SynapticsHwState *hw = comm->hwState;
+    char buf[64];
+    CARD32 now;
+    int rc;
+
+    if (!proto_data->started)
+        return FALSE;
+
+    /* only clears the fd, ReadHwState runs until nothing is due anyway */
+    do {
+        SYSCALL(rc = read(pInfo->fd, buf, sizeof(buf)));
+    } while (rc == sizeof(buf));
+
+    SynapticsResetTouchHwState(hw, FALSE);
+
+    now = priv->clock->now(priv->clock);
+    for (;;) {
+        struct RecordCursor cur = proto_data->cur;
+        const struct SynapticsRecordEvent *ev =
+            RecordNext(&proto_data->rec, &cur);
+        CARD32 millis;
+
+        if (!ev)
+            break;
+
+        millis = proto_data->start + (cur.millis - proto_data->first);
+        if ((int) (millis - now) > 0) {
+            replay_arm(proto_data, millis - now);
+            return FALSE;
+        }
+
+        proto_data->cur = cur;
+        if (EvFrameFeed(&priv->gs, &proto_data->cur_slot, hw,
+                        ev->type, ev->code, ev->value, millis)) {
+            SynapticsCopyHwState(hwRet, hw);
+            return TRUE;
+        }
+    }
+
+    if (!proto_data->finished) {
+        LogMessageVerbSigSafe(X_INFO, 0, "%s: replay finished\n", pInfo->name);
+        proto_data->finished = TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ * Read the device description from the recording header.
+ */
+static void
+ReplayReadDevDimensions(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    SynapticsParameters *para = priv->synpara;
+    struct replay_proto_data *proto_data;
+    const struct SynapticsRecordHeader *header;
+    struct SynapticsRecord rec;
+    struct RecordDevice dev;
+    int rc;
+
+    proto_data = calloc(1, sizeof(struct replay_proto_data));
+    priv->proto_data = proto_data;
+    if (!proto_data)
+        return;
+
+    rc = RecordMap(&rec, pInfo->fd);
+    if (rc) {
+        xf86IDrvMsg(pInfo, X_ERROR, "%s is not a touchpad recording: %s\n",
+                    priv->device, strerror(rc));
+        return;
+    }
+    header = rec.header;
+
+    RecordGetDevice(&rec, &dev);
+    priv->minx = dev.minx;
+    priv->maxx = dev.maxx;
+    priv->miny = dev.miny;
+    priv->maxy = dev.maxy;
+    priv->resx = dev.resx;
+    priv->resy = dev.resy;
+    if (dev.hyst_x >= 0)
+        para->hyst_x = dev.hyst_x;
+    if (dev.hyst_y >= 0)
+        para->hyst_y = dev.hyst_y;
+    priv->has_pressure = dev.has_pressure;
+    priv->minp = dev.minp;
+    priv->maxp = dev.maxp;
+    priv->has_width = dev.has_width;
+    priv->minw = dev.minw;
+    priv->maxw = dev.maxw;
+    priv->has_left = dev.has_left;
+    priv->has_semi_mt = dev.semi_mt;
+    if (dev.clickpad)
+        para->clickpad = TRUE;
+
+    /* only x/y are replayed per touch, no extra MT axes */
+    priv->has_touch = dev.max_touches > 0;
+    priv->max_touches = dev.max_touches;
+    priv->num_mt_axes = 0;
+
+    priv->id_vendor = header->vendor;
+    priv->id_product = header->product;
+
+    xf86IDrvMsg(pInfo, X_PROBED, "recording of \"%.*s\", %lu records\n",
+                (int) sizeof(header->name), header->name,
+                (unsigned long) rec.num_records);
+    xf86IDrvMsg(pInfo, X_PROBED, "x-axis range %d - %d (res %d)\n",
+                priv->minx, priv->maxx, priv->resx);
+    xf86IDrvMsg(pInfo, X_PROBED, "y-axis range %d - %d (res %d)\n",
+                priv->miny, priv->maxy, priv->resy);
+    xf86IDrvMsg(pInfo, X_PROBED, "Vendor %#hx Product %#hx\n",
+                priv->id_vendor, priv->id_product);
+
+    proto_data->valid = TRUE;
+    RecordUnmap(&rec);
+}
+
+struct SynapticsProtocolOperations replay_proto_operations = {
+    ReplayDeviceOnHook,
+    ReplayDeviceOffHook,
+    ReplayQueryHardware,
+    ReplayReadHwState,
+    NULL,                       /* needs Protocol "replay" and Device */
+    ReplayReadDevDimensions
+};
@@ -0,0 +1,154 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <xorg-server.h>
+#include "shm.h"
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "synproto.h"
+#include "synapticsstr.h"
+#include <xf86.h>
+
+static void
+shm_name(InputInfoPtr pInfo, char *name, size_t len)
+{
+    snprintf(name, len, SYNAPTICS_SHM_NAME, pInfo->dev->id);
+}
+
+/*
+ * Create the segment for the "SharedMemory" option. The server runs with
+ * more privileges than the tools reading it, so the segment is world
+ * readable but only the driver maps it writable. The name is predictable:
+ * whatever is there is removed and the segment created anew, and it is
+ * only used if it belongs to us, so nobody else can hand the server a
+ * segment they can write to.
+ */
+struct SynapticsShm *
+SynapticsShmOpen(InputInfoPtr pInfo)
+{
+    struct SynapticsShm *shm;
+    struct stat st;
+    char name[32];
+    int fd;
+
+    shm_name(pInfo, name, sizeof(name));
+
+    shm_unlink(name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        xf86IDrvMsg(pInfo, X_WARNING, "cannot create shared memory %s\n",
+                    name);
+        return NULL;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_uid != geteuid()) {
+        xf86IDrvMsg(pInfo, X_WARNING, "shared memory %s is not ours\n",
+                    name);
+        close(fd);
+        return NULL;
+    }
+
+    if (fchmod(fd, 0644) < 0 || ftruncate(fd, sizeof(*shm)) < 0) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    shm = mmap(NULL, sizeof(*shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    memset(shm, 0, sizeof(*shm));
+    shm->magic = SYNAPTICS_SHM_MAGIC;
+    shm->version = SYNAPTICS_SHM_VERSION;
+    shm->size = sizeof(*shm);
+
+    xf86IDrvMsg(pInfo, X_CONFIG, "publishing state in shared memory %s\n",
+                name);
+    return shm;
+}
+
+void
+SynapticsShmClose(InputInfoPtr pInfo, struct SynapticsShm *shm)
+{
+    char name[32];
+
+    if (!shm)
+        return;
+
+    shm_name(pInfo, name, sizeof(name));
+    munmap(shm, sizeof(*shm));
+    shm_unlink(name);
+}
+
+/*
+ * Called at the end of HandleState(). Writer side of the seqlock: the
+ * counter is odd while the fields change, readers retry until they see
+ * the same even value before and after their copy.
+ */
+void
+SynapticsShmUpdate(InputInfoPtr pInfo, const struct SynapticsHwState *hw,
+                   int buttons)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    struct SynapticsShm *shm = priv->shm;
+    int i;
+
+    shm->seq++;
+    __sync_synchronize();
+
+    shm->frames++;
+    shm->time = hw->ev_time;
+    shm->buttons = buttons;
+    shm->scroll = priv->gs.go_scroll;
+    shm->touches = priv->gs.num_active_touches;
+
+    for (i = 0; i < MAX_TP && i < SYNAPTICS_SHM_MAX_TOUCHES; i++) {
+        struct SynapticsShmTouch *t = &shm->touch[i];
+        const struct ns_inf *pti = &priv->gs.ns_info[i];
+
+        t->x = pti->hist_x;
+        t->y = pti->hist_y;
+        t->z = hw->touches[i].z;
+        t->org_x = pti->org_x;
+        t->org_y = pti->org_y;
+        t->area = pti->touch_origin;
+        t->tap_state = pti->tap_state;
+        t->typing = pti->typing;
+    }
+
+    __sync_synchronize();
+    shm->seq++;
+}
@@ -132,13 +132,15 @@ static void CalculateScalingCoeffs(SynapticsPrivate * priv);
 static void SanitizeDimensions(InputInfoPtr pInfo);
 
 void InitDeviceProperties(InputInfoPtr pInfo);
-void SetCoordsFromPercent(InputInfoPtr pInfo, int flag);
+void StopMonitor(InputInfoPtr pInfo);
 
 int SetProperty(DeviceIntPtr dev, Atom property, XIPropertyValuePtr prop,
                 BOOL checkonly);
+int GetProperty(DeviceIntPtr dev, Atom property);
 
 
-static CARD32 timerFunc(OsTimerPtr timer, CARD32 now, pointer arg);
+static Bool XClockInit(struct XClock *xclock);
+static const struct GestureSink gesture_sink;
 
 const static struct {
     const char *name;
@@ -146,6 +148,7 @@ const static struct {
 } protocols[] = {
 #ifdef BUILD_EVENTCOMM
     { "event", &event_proto_operations },
+    { "replay", &replay_proto_operations },
 #endif
     { NULL, NULL }
 };
@@ -309,103 +312,57 @@ set_percent_option(pointer options, const char *optname,
 }
 
 static void
-set_default_parameters(InputInfoPtr pInfo)
+set_default_parameters(InputInfoPtr pInfo, pointer opts,
+                       SynapticsParameters *pars)
 {
     SynapticsPrivate *priv = pInfo->private;    /* read-only */
-    pointer opts = pInfo->options;      /* read-only */
-    SynapticsParameters *pars = &priv->synpara; /* modified */
-
-    int horizScrollDelta, vertScrollDelta;      /* pixels */
-    int tapMove;                /* pixels */
-    double accelFactor;         /* 1/pixels */
-    int fingerLow, fingerHigh;  /* pressure */
-    int pressureMotionMinZ, pressureMotionMaxZ; /* pressure */
-    Bool vertTwoFingerScroll, horizTwoFingerScroll;
-    int horizResolution = 1;
-    int vertResolution = 1;
-    int width, height, diag, range;
-    int horizHyst, vertHyst;
+
+    SynapticsParameters defaults = *pars;       /* keeps probed values */
+    int width, height;
     int grab_event_device = 0;
     const char *source;
 
-    /* The synaptics specs specify typical edge widths of 4% on x, and 5.4% on
-     * y (page 7) [Synaptics TouchPad Interfacing Guide, 510-000080 - A
-     * Second Edition, http://www.synaptics.com/support/dev_support.cfm, 8 Sep
-     * 2008]. We use 7% for both instead for synaptics devices, and 15% for
-     * ALPS models.
-     * http://bugs.freedesktop.org/show_bug.cgi?id=21214
-     *
-     * If the range was autodetected, apply these edge widths to all four
-     * sides.
-     */
-
     width = abs(priv->maxx - priv->minx);
     height = abs(priv->maxy - priv->miny);
-    diag = sqrt(width * width + height * height);
-
-    /* Again, based on typical x/y range and defaults */
-    horizScrollDelta = diag * .020;
-    vertScrollDelta = diag * .020;
-    tapMove = diag * .044;
-    accelFactor = 200.0 / diag; /* trial-and-error */
-
-    /* hysteresis, assume >= 0 is a detected value (e.g. evdev fuzz) */
-    horizHyst = pars->hyst_x >= 0 ? pars->hyst_x : diag * 0.005;
-    vertHyst = pars->hyst_y >= 0 ? pars->hyst_y : diag * 0.005;
 
-    range = priv->maxp - priv->minp + 1;
-
-    /* scaling based on defaults and a pressure of 256 */
-    pressureMotionMinZ = priv->minp + range * (30.0 / 256);
-//    pressureMotionMaxZ = priv->minp + range * (160.0 / 256);
-    pressureMotionMaxZ = 90;
-
-    range = priv->maxw - priv->minw + 1;
-
-    /* Enable twofinger scroll if we can detect doubletap */
-    vertTwoFingerScroll = FALSE;
-    horizTwoFingerScroll = FALSE;
-
-    /* Use resolution reported by hardware if available */
-    if ((priv->resx > 0) && (priv->resy > 0)) {
-        horizResolution = priv->resx;
-        vertResolution = priv->resy;
-    }
+    GestureDefaultParameters(&defaults, priv->minx, priv->maxx,
+                             priv->miny, priv->maxy, priv->minp, priv->maxp,
+                             priv->resx, priv->resy);
 
     /* set the parameters */
     pars->hyst_x =
-        set_percent_option(opts, "HorizHysteresis", width, 0, horizHyst);
+        set_percent_option(opts, "HorizHysteresis", width, 0, defaults.hyst_x);
     pars->hyst_y =
-        set_percent_option(opts, "VertHysteresis", height, 0, vertHyst);
+        set_percent_option(opts, "VertHysteresis", height, 0, defaults.hyst_y);
 
-    pars->finger_low = xf86SetIntOption(opts, "FingerLow", fingerLow);
-    pars->finger_high = xf86SetIntOption(opts, "FingerHigh", fingerHigh);
-    pars->tap_time = xf86SetIntOption(opts, "MaxTapTime", 180);
-    pars->tap_move = xf86SetIntOption(opts, "MaxTapMove", tapMove);
+    pars->finger_low = xf86SetIntOption(opts, "FingerLow", defaults.finger_low);
+    pars->finger_high = xf86SetIntOption(opts, "FingerHigh", defaults.finger_high);
+    pars->tap_time = xf86SetIntOption(opts, "MaxTapTime", defaults.tap_time);
+    pars->tap_move = xf86SetIntOption(opts, "MaxTapMove", defaults.tap_move);
     pars->clickpad = xf86SetBoolOption(opts, "ClickPad", pars->clickpad);       /* Probed */
     if (pars->clickpad)
     pars->scroll_dist_vert =
-        xf86SetIntOption(opts, "VertScrollDelta", vertScrollDelta);
+        xf86SetIntOption(opts, "VertScrollDelta", defaults.scroll_dist_vert);
     pars->scroll_dist_horiz =
-        xf86SetIntOption(opts, "HorizScrollDelta", horizScrollDelta);
+        xf86SetIntOption(opts, "HorizScrollDelta", defaults.scroll_dist_horiz);
     pars->scroll_twofinger_vert =
-        xf86SetBoolOption(opts, "VertTwoFingerScroll", vertTwoFingerScroll);
+        xf86SetBoolOption(opts, "VertTwoFingerScroll", defaults.scroll_twofinger_vert);
     pars->scroll_twofinger_horiz =
-        xf86SetBoolOption(opts, "HorizTwoFingerScroll", horizTwoFingerScroll);
-    pars->touchpad_off = xf86SetIntOption(opts, "TouchpadOff", TOUCHPAD_ON);
+        xf86SetBoolOption(opts, "HorizTwoFingerScroll", defaults.scroll_twofinger_horiz);
+    pars->touchpad_off = xf86SetIntOption(opts, "TouchpadOff", defaults.touchpad_off);
 
     pars->press_motion_min_z =
-        xf86SetIntOption(opts, "PressureMotionMinZ", pressureMotionMinZ);
+        xf86SetIntOption(opts, "PressureMotionMinZ", defaults.press_motion_min_z);
     pars->press_motion_max_z =
-        xf86SetIntOption(opts, "PressureMotionMaxZ", pressureMotionMaxZ);
+        xf86SetIntOption(opts, "PressureMotionMaxZ", defaults.press_motion_max_z);
 
-    pars->min_speed = xf86SetRealOption(opts, "MinSpeed", 0.4);
-    pars->max_speed = xf86SetRealOption(opts, "MaxSpeed", 0.7);
-    pars->accl = xf86SetRealOption(opts, "AccelFactor", accelFactor);
+    pars->min_speed = xf86SetRealOption(opts, "MinSpeed", defaults.min_speed);
+    pars->max_speed = xf86SetRealOption(opts, "MaxSpeed", defaults.max_speed);
+    pars->accl = xf86SetRealOption(opts, "AccelFactor", defaults.accl);
     pars->press_motion_min_factor =
-        xf86SetRealOption(opts, "PressureMotionMinFactor", 1.0);
+        xf86SetRealOption(opts, "PressureMotionMinFactor", defaults.press_motion_min_factor);
     pars->press_motion_max_factor =
-        xf86SetRealOption(opts, "PressureMotionMaxFactor", 10.0);
+        xf86SetRealOption(opts, "PressureMotionMaxFactor", defaults.press_motion_max_factor);
 
     /* Only grab the device by default if it's not coming from a config
        backend. This way we avoid the device being added twice and sending
@@ -417,9 +374,9 @@ set_default_parameters(InputInfoPtr pInfo)
     pars->grab_event_device = xf86SetBoolOption(opts, "GrabEventDevice", grab_event_device);
 
     pars->resolution_horiz =
-        xf86SetIntOption(opts, "HorizResolution", horizResolution);
+        xf86SetIntOption(opts, "HorizResolution", defaults.resolution_horiz);
     pars->resolution_vert =
-        xf86SetIntOption(opts, "VertResolution", vertResolution);
+        xf86SetIntOption(opts, "VertResolution", defaults.resolution_vert);
     if (pars->resolution_horiz <= 0) {
         xf86IDrvMsg(pInfo, X_ERROR,
                     "Invalid X resolution, using 1 instead.\n");
@@ -431,20 +388,107 @@ set_default_parameters(InputInfoPtr pInfo)
         pars->resolution_vert = 1;
     }
 
-    pars->bottom_buttons_height=xf86SetIntOption(opts, "BottomButtonsHeight", 25);
-	pars->bottom_buttons_sep_pos=xf86SetIntOption(opts, "BottomButtonsSepPos", 50);
-	pars->bottom_buttons_sep_width=xf86SetIntOption(opts, "BottomButtonsSepWidth", 2);
+    pars->bottom_buttons_height=xf86SetIntOption(opts, "BottomButtonsHeight", defaults.bottom_buttons_height);
+	pars->bottom_buttons_sep_pos=xf86SetIntOption(opts, "BottomButtonsSepPos", defaults.bottom_buttons_sep_pos);
+	pars->bottom_buttons_sep_width=xf86SetIntOption(opts, "BottomButtonsSepWidth", defaults.bottom_buttons_sep_width);
+
+	pars->top_buttons_height=xf86SetIntOption(opts, "TopButtonsHeight", defaults.top_buttons_height);
+	pars->top_buttons_middle_width=xf86SetIntOption(opts, "TopButtonsMiddleWidth", defaults.top_buttons_middle_width);
+
+	pars->scroll_twofinger_finger_size=xf86SetIntOption(opts, "TwoFingerScrollFingerSize", defaults.scroll_twofinger_finger_size);
+
+	pars->tap_pressure = xf86SetIntOption(opts, "MinTapPressure", defaults.tap_pressure);
+	pars->tap_anywhere = xf86SetIntOption(opts, "TapAnywhere", defaults.tap_anywhere);
+	pars->tap_hold = xf86SetIntOption(opts, "TapHoldGuesture", defaults.tap_hold);
+
+	pars->typing_timeout = xf86SetIntOption(opts, "TypingTimeout", defaults.typing_timeout);
+	if (pars->typing_timeout < 0)
+		pars->typing_timeout = 0;
+
+	UpdateDerivedParameters(priv, pars, PD_ALL);
+}
+
+/*
+ * Named profiles: every option given as "Profile.<name>.<Option>" adds the
+ * profile <name>, which is the base configuration with these options
+ * replaced. Each profile is a complete parameter set including its derived
+ * values, switching only swaps priv->synpara.
+ */
+static int
+find_profile(SynapticsPrivate *priv, const char *name, int len)
+{
+    int i;
+
+    for (i = 0; i < priv->num_profiles; i++) {
+        if (strlen(priv->profile_names[i]) == len &&
+            strncasecmp(priv->profile_names[i], name, len) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static void
+set_profile_parameters(InputInfoPtr pInfo, const SynapticsParameters *probed)
+{
+    SynapticsPrivate *priv = pInfo->private;
+    pointer opt;
+    int i;
+
+    priv->num_profiles = 1;
+    priv->profile_names[0] = strdup("default");
+    if (!priv->profile_names[0])
+        return;
+
+    for (opt = xf86FirstOption(pInfo->options); opt; opt = xf86NextOption(opt)) {
+        const char *name = xf86OptionName(opt);
+        const char *dot;
+
+        if (strncasecmp(name, "Profile.", 8) != 0)
+            continue;
+
+        name += 8;
+        dot = strchr(name, '.');
+        if (!dot || dot == name || find_profile(priv, name, dot - name) >= 0)
+            continue;
+
+        if (priv->num_profiles == SYN_MAX_PROFILES) {
+            xf86IDrvMsg(pInfo, X_ERROR, "Too many profiles, ignoring %.*s\n",
+                        (int) (dot - name), name);
+            continue;
+        }
+
+        priv->profile_names[priv->num_profiles] = strndup(name, dot - name);
+        if (priv->profile_names[priv->num_profiles])
+            priv->num_profiles++;
+    }
+
+    for (i = 1; i < priv->num_profiles; i++) {
+        const char *pname = priv->profile_names[i];
+        pointer opts;
+
+        opts = xf86OptionListDuplicate(pInfo->options);
+        for (opt = xf86FirstOption(pInfo->options); opt;
+             opt = xf86NextOption(opt)) {
+            const char *name = xf86OptionName(opt);
 
-	pars->top_buttons_height=xf86SetIntOption(opts, "TopButtonsHeight", 15);
-	pars->top_buttons_middle_width=xf86SetIntOption(opts, "TopButtonsMiddleWidth", 16);
+            if (strncasecmp(name, "Profile.", 8) != 0 ||
+                strncasecmp(name + 8, pname, strlen(pname)) != 0 ||
+                name[8 + strlen(pname)] != '.')
+                continue;
 
-	pars->scroll_twofinger_finger_size=xf86SetIntOption(opts, "TwoFingerScrollFingerSize", 18);
+            opts = xf86ReplaceStrOption(opts, name + 8 + strlen(pname) + 1,
+                                        xf86OptionValue(opt));
+        }
 
-	pars->tap_pressure = xf86SetIntOption(opts, "MinTapPressure", 50);
-	pars->tap_anywhere = xf86SetIntOption(opts, "TapAnywhere", 0);
-	pars->tap_hold = xf86SetIntOption(opts, "TapHoldGuesture", 160);
+        xf86IDrvMsg(pInfo, X_CONFIG, "Loading profile %s\n", pname);
+        priv->profiles[i] = *probed;
+        set_default_parameters(pInfo, opts, &priv->profiles[i]);
+        xf86OptionListFree(opts);
 
-	SetCoordsFromPercent(pInfo,0);
+        /* the grab is taken when the device is enabled, not per profile */
+        priv->profiles[i].grab_event_device =
+            priv->profiles[0].grab_event_device;
+    }
 }
 
 static double
@@ -454,7 +498,7 @@ SynapticsAccelerationProfile(DeviceIntPtr dev,
 {
     InputInfoPtr pInfo = dev->public.devicePrivate;
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    SynapticsParameters *para = &priv->synpara;
+    SynapticsParameters *para = priv->synpara;
 
     double accelfct;
 
@@ -501,11 +545,16 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
 {
     SynapticsPrivate *priv;
 
+    SynapticsParameters probed;
+    int i;
+
     /* allocate memory for SynapticsPrivateRec */
     priv = calloc(1, sizeof(SynapticsPrivate));
     if (!priv)
         return BadAlloc;
 
+    priv->synpara = &priv->profiles[0];
+
     pInfo->type_name = XI_TOUCHPAD;
     pInfo->device_control = DeviceControl;
     pInfo->read_input = ReadInput;
@@ -514,20 +563,13 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
     pInfo->private = priv;
 
 
-    /* allocate now so we don't allocate in the signal handler */
-    priv->timer = TimerSet(NULL, 0, 0, NULL, NULL);
-    if (!priv->timer) {
+    if (!XClockInit(&priv->xclock)) {
         free(priv);
         return BadAlloc;
     }
+    priv->clock = &priv->xclock.clock;
 
-	// alocate ns
-	priv->ns_info=calloc(MAX_TP, sizeof(struct ns_inf));
-    if (!priv->ns_info) {
-        xf86IDrvMsg(pInfo, X_ERROR,
-                    "Synaptics driver can't allocate memory\n");
-        goto SetupProc_fail;
-    }
+    GestureInit(&priv->gs, &gesture_sink, pInfo);
 
     /* may change pInfo->options */
     if (!SetDeviceAndProtocol(pInfo)) {
@@ -537,6 +579,9 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
     }
 
     priv->device = xf86FindOptionValue(pInfo->options, "Device");
+    priv->typing_keyboard = xf86FindOptionValue(pInfo->options,
+                                                "TypingKeyboard");
+    priv->use_shm = xf86SetBoolOption(pInfo->options, "SharedMemory", FALSE);
 
     /* open the touchpad device */
     pInfo->fd = xf86OpenSerial(pInfo->options);
@@ -548,19 +593,17 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
     xf86IDrvMsg(pInfo, X_WARNING, "SynapticsPreInit fd: %d\n",pInfo->fd);
 
     /* initialize variables */
-    priv->synpara.hyst_x = -1;
-    priv->synpara.hyst_y = -1;
-
-    priv->go_scroll=FALSE;
-	priv->btn_up_time=0;
-	priv->tap_start_time=0;
+    priv->synpara->hyst_x = -1;
+    priv->synpara->hyst_y = -1;
 
     /* read hardware dimensions */
     ReadDevDimensions(pInfo);
 
-    set_default_parameters(pInfo);
+    probed = *priv->synpara;
+    set_default_parameters(pInfo, pInfo->options, priv->synpara);
+    set_profile_parameters(pInfo, &probed);
 
-    SynapticsParameters *pars = &priv->synpara;
+    SynapticsParameters *pars = priv->synpara;
 
 #ifndef NO_DRIVER_SCALING
     CalculateScalingCoeffs(priv);
@@ -587,13 +630,13 @@ SynapticsPreInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
  SetupProc_fail:
     SynapticsCloseFd(pInfo);
 
-    if (priv->ns_info)
-		free(priv->ns_info);
+    for (i = 0; i < priv->num_profiles; i++)
+        free(priv->profile_names[i]);
 
     if (priv->comm.buffer)
         XisbFree(priv->comm.buffer);
     free(priv->proto_data);
-    free(priv->timer);
+    free(priv->xclock.timer);
     free(priv);
     pInfo->private = NULL;
     return BadAlloc;
@@ -606,11 +649,14 @@ static void
 SynapticsUnInit(InputDriverPtr drv, InputInfoPtr pInfo, int flags)
 {
     SynapticsPrivate *priv = ((SynapticsPrivate *) pInfo->private);
+    int i;
 
-    if (priv && priv->timer)
-        free(priv->timer);
-	if (priv && priv->ns_info)
-        free(priv->ns_info);
+    if (priv && priv->xclock.timer)
+        free(priv->xclock.timer);
+    if (priv && priv->monitor.timer)
+        free(priv->monitor.timer);
+    for (i = 0; priv && i < priv->num_profiles; i++)
+        free(priv->profile_names[i]);
     if (priv && priv->proto_data)
         free(priv->proto_data);
     if (priv && priv->scroll_events_mask)
@@ -672,7 +718,7 @@ DeviceOn(DeviceIntPtr dev)
     }
 
     if (priv->proto_ops->DeviceOnHook &&
-        !priv->proto_ops->DeviceOnHook(pInfo, &priv->synpara))
+        !priv->proto_ops->DeviceOnHook(pInfo, priv->synpara))
          goto error;
 
     priv->comm.buffer = XisbNew(pInfo->fd, INPUT_BUFFER_SIZE);
@@ -686,6 +732,7 @@ DeviceOn(DeviceIntPtr dev)
         goto error;
 
     xf86AddEnabledDevice(pInfo);
+    TypingMonitorOn(pInfo, priv->typing_keyboard);
     dev->public.on = TRUE;
 
     return Success;
@@ -702,33 +749,11 @@ error:
 static void
 SynapticsReset(SynapticsPrivate * priv)
 {
-    int i;
-
     SynapticsResetHwState(priv->hwState);
     SynapticsResetHwState(priv->local_hw_state);
     SynapticsResetHwState(priv->comm.hwState);
 
-    priv->hyst_center_x = 0;
-    priv->hyst_center_y = 0;
-	priv->scroll_delta_x=0;
-	priv->scroll_delta_y=0;
-
-    priv->lastButtons = 0;
-    priv->num_active_touches = 0;
-
-    priv->go_scroll=FALSE;
-	priv->btn_up_time=0;
-
-    priv->timer_time=1;
-    priv->timer_click_mask=0;
-    priv->timer_click_finish=FALSE;
-
-    priv->tap_start_time=0;
-
-	memset(priv->ns_info, 0,MAX_TP*sizeof(struct ns_inf));
-
-    for (i = 0; i < MAX_TP; i++)
-		priv->ns_info[i].touch_origin=TO_CLOSED;
+    GestureReset(&priv->gs);
 }
 
 static int
@@ -743,7 +768,9 @@ DeviceOff(DeviceIntPtr dev)
     DBG(3, "Synaptics DeviceOff called\n");
 
     if (pInfo->fd != -1) {
-        TimerCancel(priv->timer);
+        priv->clock->set_timer(priv->clock, 0, NULL, NULL);
+        StopMonitor(pInfo);
+        TypingMonitorOff(pInfo);
         xf86RemoveEnabledDevice(pInfo);
         SynapticsReset(priv);
 
@@ -773,10 +800,12 @@ DeviceClose(DeviceIntPtr dev)
 
 
     RetValue = DeviceOff(dev);
-    TimerFree(priv->timer);
-    priv->timer = NULL;
-	free(priv->ns_info);
-	priv->ns_info=NULL;
+    TimerFree(priv->xclock.timer);
+    priv->xclock.timer = NULL;
+    TimerFree(priv->monitor.timer);
+    priv->monitor.timer = NULL;
+    SynapticsShmClose(pInfo, priv->shm);
+    priv->shm = NULL;
 
     free(priv->touch_axes);
     priv->touch_axes = NULL;
@@ -885,6 +914,7 @@ DeviceInit(DeviceIntPtr dev)
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
     Atom float_type, prop;
     float tmpf;
+    double min_speed;
     unsigned char map[SYN_MAX_BUTTONS + 1];
     int i;
     int min, max;
@@ -931,9 +961,11 @@ DeviceInit(DeviceIntPtr dev)
         /* float property type */
         float_type = XIGetKnownProperty(XATOM_FLOAT);
 
+        min_speed = priv->synpara->min_speed;
+
         /* translate MinAcc to constant deceleration.
          * May be overridden in xf86InitValuatorDefaults */
-        tmpf = 1.0 / priv->synpara.min_speed;
+        tmpf = 1.0 / min_speed;
 
         xf86IDrvMsg(pInfo, X_CONFIG,
                     "(accel) MinSpeed is now constant deceleration " "%.1f\n",
@@ -942,18 +974,20 @@ DeviceInit(DeviceIntPtr dev)
         XIChangeDeviceProperty(dev, prop, float_type, 32,
                                PropModeReplace, 1, &tmpf, FALSE);
 
-        /* adjust accordingly */
-        priv->synpara.max_speed /= priv->synpara.min_speed;
-        priv->synpara.min_speed = 1.0;
+        /* adjust accordingly, the deceleration is shared by all profiles */
+        for (i = 0; i < priv->num_profiles; i++) {
+            priv->profiles[i].max_speed /= min_speed;
+            priv->profiles[i].min_speed /= min_speed;
+        }
 
         /* synaptics seems to report 80 packet/s, but dix scales for
          * 100 packet/s by default. */
         pVel->corr_mul = 12.5f; /*1000[ms]/80[/s] = 12.5 */
 
         xf86IDrvMsg(pInfo, X_CONFIG, "(accel) MaxSpeed is now %.2f\n",
-                    priv->synpara.max_speed);
+                    priv->synpara->max_speed);
         xf86IDrvMsg(pInfo, X_CONFIG, "(accel) AccelFactor is now %.3f\n",
-                    priv->synpara.accl);
+                    priv->synpara->accl);
 
         prop = XIGetKnownProperty(ACCEL_PROP_PROFILE_NUMBER);
         i = AccelProfileDeviceSpecific;
@@ -1006,9 +1040,9 @@ DeviceInit(DeviceIntPtr dev)
     }
 
     SetScrollValuator(dev, priv->scroll_axis_horiz, SCROLL_TYPE_HORIZONTAL,
-                      priv->synpara.scroll_dist_horiz, 0);
+                      priv->synpara->scroll_dist_horiz, 0);
     SetScrollValuator(dev, priv->scroll_axis_vert, SCROLL_TYPE_VERTICAL,
-                      priv->synpara.scroll_dist_vert, 0);
+                      priv->synpara->scroll_dist_vert, 0);
 
     DeviceInitTouch(dev, axes_labels);
 
@@ -1026,7 +1060,10 @@ DeviceInit(DeviceIntPtr dev)
 
     InitDeviceProperties(pInfo);
 
-    XIRegisterPropertyHandler(pInfo->dev, SetProperty, NULL, NULL);
+    XIRegisterPropertyHandler(pInfo->dev, SetProperty, GetProperty, NULL);
+
+    if (priv->use_shm)
+        priv->shm = SynapticsShmOpen(pInfo);
 
     SynapticsReset(priv);
 
@@ -1039,122 +1076,150 @@ DeviceInit(DeviceIntPtr dev)
 }
 
 
-static enum TouchOrigin
-current_button_area_new(SynapticsParameters *para, int x, int y, struct ns_inf *pti)
+/*
+ * The first post for a frame ends its latency, see SYNAPTICS_PROP_LATENCY.
+ * Posts from the timer don't belong to a frame and aren't counted.
+ */
+static void
+LatencyRecord(SynapticsPrivate * priv)
 {
-		if(y<para->no_button_min_y){
-			pti->vert_area=VA_TOP;
-			if(x<para->top_mid_lx) return TO_LEFT_CLICK;
-			else if(x>para->top_mid_rx) return TO_RIGHT_CLICK;
-			else return TO_MIDDLE_CLICK;
-		}else if (y>para->no_button_max_y){
-			pti->vert_area=VA_BOT;
-			if(x<para->bottom_left_btn_rx) return TO_LEFT_CLICK;
-			else if(x>para->bottom_right_btn_lx) return TO_RIGHT_CLICK;
-			else return TO_BTN_GAP;
-		}else{
-			pti->vert_area=VA_MID;
-			return TO_NO_CLICK;
-		}
+    INT32 lat = priv->clock->now(priv->clock) - priv->latency.frame_time;
+    int bucket = 0;
+
+    priv->latency.pending = FALSE;
+
+    while (lat > 0 && bucket < SYNAPTICS_LAT_COUNT - 1) {
+        lat >>= 1;
+        bucket++;
+    }
+    priv->latency.hist[bucket]++;
 }
-static void inline
-timerClick(InputInfoPtr pInfo, struct ns_inf *pti){
+
+/*
+ * The gesture engine's output, see gesture.h. All of it is called from
+ * ReadInput() or from the clock's timer with SIGIO blocked.
+ */
+static void
+gesture_post_motion(void *data, int dx, int dy)
+{
+    InputInfoPtr pInfo = data;
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
+
+    if (priv->latency.pending)
+        LatencyRecord(priv);
+    xf86PostMotionEvent(pInfo->dev, 0, 0, 2, dx, dy);
+}
+
+static void
+gesture_post_button(void *data, int button, Bool is_down)
+{
+    InputInfoPtr pInfo = data;
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    SynapticsParameters *para = &priv->synpara;
-
-	if(priv->timer_click_finish){
-		xf86PostButtonEvent(pInfo->dev, FALSE, priv->timer_click_mask, FALSE, 0, 0);
-		priv->timer_click_finish=FALSE;
-		priv->timer_click_mask=0;
-	}else if(priv->timer_delta_x<para->tap_move && priv->timer_delta_y<para->tap_move){
-		xf86PostButtonEvent(pInfo->dev, FALSE, priv->timer_click_mask, TRUE, 0, 0);
-		pti->tap_state=TS_NONE;
-		// 5 mills tap length
-		priv->timer = TimerSet(priv->timer, 0, 5, timerFunc, pInfo);
-		priv->timer_click_finish=TRUE;
-		priv->timer_time=0;
-	}
 
+    if (priv->latency.pending)
+        LatencyRecord(priv);
+    xf86PostButtonEvent(pInfo->dev, FALSE, button, is_down, 0, 0);
 }
 
 static void
-post_scroll_events(const InputInfoPtr pInfo)
+gesture_post_scroll(void *data, int dx, int dy)
 {
+    InputInfoPtr pInfo = data;
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
 
     valuator_mask_zero(priv->scroll_events_mask);
 
-    if (priv->scroll_delta_y != 0) {
+    if (dy != 0) {
         valuator_mask_set_double(priv->scroll_events_mask,
-                                 priv->scroll_axis_vert, priv->scroll_delta_y);
+                                 priv->scroll_axis_vert, dy);
     }
-    if (priv->scroll_delta_x != 0) {
+    if (dx != 0) {
         valuator_mask_set_double(priv->scroll_events_mask,
-                                 priv->scroll_axis_horiz, priv->scroll_delta_x);
+                                 priv->scroll_axis_horiz, dx);
     }
-    if (valuator_mask_num_valuators(priv->scroll_events_mask))
+    if (valuator_mask_num_valuators(priv->scroll_events_mask)) {
+        if (priv->latency.pending)
+            LatencyRecord(priv);
 		xf86PostMotionEventM(pInfo->dev, FALSE, priv->scroll_events_mask);
+    }
 }
 
-static CARD32
-timerFunc(OsTimerPtr timer, CARD32 now, pointer arg)
+static void
+gesture_timer_expired(void *arg)
 {
     InputInfoPtr pInfo = arg;
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    SynapticsParameters *para = &priv->synpara;
-    struct ns_inf *pti = priv->ns_info;
-    int sigstate;
-	int i=0;
-
-    sigstate = xf86BlockSIGIO();
 
+    GestureTimer(&priv->gs, priv->synpara);
+}
 
-	// finish click if needed;
-	if(priv->timer_click_finish){
-		timerClick(pInfo,NULL);
-		i=1; //<-- so we don't go into THG loop
-	};
+static void
+gesture_set_timer(void *data, CARD32 millis)
+{
+    InputInfoPtr pInfo = data;
+    SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
 
-	if(priv->timer_y_scroll){
-		// hand cont. scroll
+    priv->clock->set_timer(priv->clock, millis, gesture_timer_expired, pInfo);
+}
 
-		if(priv->timer_y_scroll>0) priv->timer_y_scroll-=50;
-		else priv->timer_y_scroll+=50;
+static const struct GestureSink gesture_sink = {
+    gesture_post_motion,
+    gesture_post_button,
+    gesture_post_scroll,
+    gesture_set_timer,
+};
 
-		if(abs(priv->timer_y_scroll)>50){
+/*
+ * The X server clock, see clock.h. The timer callback runs from the
+ * server's timer handling with SIGIO blocked.
+ */
+static CARD32
+xclock_now(struct SynapticsClock *clock)
+{
+    return GetTimeInMillis();
+}
 
-			priv->scroll_delta_y=priv->timer_y_scroll;
-			post_scroll_events(pInfo);
-			priv->timer = TimerSet(priv->timer, 0, 64, timerFunc, pInfo);
+static CARD32
+timerFunc(OsTimerPtr timer, CARD32 now, pointer arg)
+{
+    struct XClock *xclock = arg;
+    int sigstate;
 
-		} else priv->timer_y_scroll=0;
+    sigstate = xf86BlockSIGIO();
 
-		priv->scroll_delta_y=0;
-		priv->timer_time=0;
+    xclock->func(xclock->arg);
 
-	}else if(!i){
-		// handle THG
+    xf86UnblockSIGIO(sigstate);
 
-		for(i=0;i<MAX_TP;i++){
-			if(pti->tap_state==TS_WAIT){
-				timerClick(pInfo,pti);
-			}else if(pti->tap_state==TS_THG_WAIT){
-				pti->tap_state=TS_THG; // we are now in THG mode
-			}
-			pti++;
-		}
+    return 0;
+}
 
-		priv->timer_time=0;
+static void
+xclock_set_timer(struct SynapticsClock *clock, CARD32 millis,
+                 ClockTimerFunc func, void *arg)
+{
+    struct XClock *xclock = (struct XClock *) clock;
 
-	}
+    if (millis) {
+        xclock->func = func;
+        xclock->arg = arg;
+        xclock->timer = TimerSet(xclock->timer, 0, millis, timerFunc, xclock);
+    } else
+        TimerCancel(xclock->timer);
+}
 
-    xf86UnblockSIGIO(sigstate);
+static Bool
+XClockInit(struct XClock *xclock)
+{
+    xclock->clock.now = xclock_now;
+    xclock->clock.set_timer = xclock_set_timer;
 
-    return 0;
+    /* allocate now so we don't allocate in the signal handler */
+    xclock->timer = TimerSet(NULL, 0, 0, NULL, NULL);
 
+    return xclock->timer != NULL;
 }
 
-
 static Bool
 SynapticsGetHwState(InputInfoPtr pInfo, SynapticsPrivate * priv,
                     struct SynapticsHwState *hw)
@@ -1180,59 +1245,36 @@ ReadInput(InputInfoPtr pInfo)
         SynapticsCopyHwState(priv->hwState, hw);
 
         HandleState(pInfo, hw);
-
-		//~ xf86IDrvMsg(pInfo, X_INFO,"closed slot: %d\n",i);
-
-        if(priv->timer_time){
-			if(priv->timer_time>1) priv->timer = TimerSet(priv->timer, 0, priv->timer_time, timerFunc, pInfo);
-			else TimerCancel(priv->timer);
-			priv->timer_time=0;
-		}
 	}
 }
 
 
-/**
- * Applies hysteresis. center is shifted such that it is in range with
- * in by the margin again. The new center is returned.
- * @param in the current value
- * @param center the current center
- * @param margin the margin to center in which no change is applied
- * @return the new center (which might coincide with the previous)
- */
-static int
-hysteresis(int in, int center, int margin)
+/* Record the post-filter state for the monitor, it is published later from
+ * the monitor timer. */
+static void
+MonitorSnapshot(SynapticsPrivate * priv, const struct SynapticsHwState *hw,
+                int buttons)
 {
-    int diff = in - center;
+    INT32 *state = priv->monitor.state;
+    int i;
 
-    if (abs(diff) <= margin) {
-        diff = 0;
-    }
-    else if (diff > margin) {
-        diff -= margin;
-    }
-    else if (diff < -margin) {
-        diff += margin;
-    }
-    return center + diff;
-}
+    state[SYNAPTICS_MON_TIME] = hw->ev_time;
+    state[SYNAPTICS_MON_BUTTONS] = buttons;
+    state[SYNAPTICS_MON_SCROLL] = priv->gs.go_scroll;
+    state[SYNAPTICS_MON_TOUCHES] = priv->gs.num_active_touches;
 
-static void
-post_button_click(const InputInfoPtr pInfo, const int button)
-{
-    xf86PostButtonEvent(pInfo->dev, FALSE, button, TRUE, 0, 0);
-    xf86PostButtonEvent(pInfo->dev, FALSE, button, FALSE, 0, 0);
-}
+    for (i = 0; i < MAX_TP && i < SYNAPTICS_MON_MAX_TOUCHES; i++) {
+        INT32 *t = state + SYNAPTICS_MON_TOUCH_BASE + i * SYNAPTICS_MON_TOUCH_SIZE;
+        const struct ns_inf *pti = &priv->gs.ns_info[i];
 
-static void
-filter_jitter(SynapticsPrivate * priv, int *x, int *y, struct ns_inf *pti)
-{
-    SynapticsParameters *para = &priv->synpara;
+        t[SYNAPTICS_MON_TOUCH_X] = pti->hist_x;
+        t[SYNAPTICS_MON_TOUCH_Y] = pti->hist_y;
+        t[SYNAPTICS_MON_TOUCH_Z] = hw->touches[i].z;
+        t[SYNAPTICS_MON_TOUCH_AREA] = pti->touch_origin;
+        t[SYNAPTICS_MON_TOUCH_TAP] = pti->tap_state;
+    }
 
-    pti->hyst_center_x = hysteresis(*x, pti->hyst_center_x, para->hyst_x);
-    pti->hyst_center_y = hysteresis(*y, pti->hyst_center_y, para->hyst_y);
-    *x = pti->hyst_center_x;
-    *y = pti->hyst_center_y;
+    priv->monitor.dirty = TRUE;
 }
 
 /*
@@ -1243,283 +1285,18 @@ static void
 HandleState(InputInfoPtr pInfo, struct SynapticsHwState *hw)
 {
     SynapticsPrivate *priv = (SynapticsPrivate *) (pInfo->private);
-    SynapticsParameters *para = &priv->synpara;
-    struct TouchData *hwt = hw->touches;
-    struct ns_inf *pti = priv->ns_info;
-    int dx = 0, dy = 0, buttons=0,id;
-    int change;
-
-	int temp=0;
-	int new_two_down=0;
-
-	int i;
-	int x,y;
-	enum TouchOrigin cba;
-	int potential_click=0;
-
-	priv->scroll_delta_y=0;
-	priv->scroll_delta_x=0;
-
-	// syndaemon
-	if(para->touchpad_off==TOUCHPAD_OFF) return;
-
-	for (i = 0; i < MAX_TP; i++) {
-
-		hwt+=i;
-		pti+=i;
-
-		// slot is empty
-		if(!hwt->slot_state) continue;
-
-        if (hwt->slot_state == SLOTSTATE_CLOSE){
-
-			// tap_anywhere option
-			if(!pti->touch_origin) pti->touch_origin+=para->tap_anywhere;
-
-			// handle tap
-			if(para->touchpad_off!=TOUCHPAD_TAP_OFF && pti->tap_go &&
-				(pti->tap_state==TS_THG || // <-- we are in THG mode
-				pti->touch_origin>TO_NO_CLICK && // <-- first tap or second with timer ON
-				(hw->ev_time - hwt->millis) < para->tap_time &&
-				hw->ev_time > priv->btn_up_time && // <-- button click delay
-				abs(pti->org_x-pti->hist_x)<para->tap_move &&
-				abs(pti->org_y-pti->hist_y)<para->tap_move)){
-
-				switch(pti->tap_state){
-					case TS_NONE: // first tap release
-						if(!para->tap_hold){
-							post_button_click(pInfo, ffs(pti->touch_origin));
-							break;
-						}
-						if(pti->triple_click_timeout>hw->ev_time)
-							timerClick(pInfo,pti);
-						else{
-							priv->timer_click_mask=ffs(pti->touch_origin);
-							priv->timer_time=para->tap_hold; // <-Start THG timer
-							pti->tap_state=TS_WAIT;
-							priv->timer_delta_x=0;
-							priv->timer_delta_y=0;
-						}
-						pti->triple_click_timeout=0;
-						break;
-					case TS_WAIT: // <-- this gets switched by the timer(TS_NONE + clicked) or if we touch down(TS_THG_WAIT/TS_NONE)
-					case TS_THG_WAIT: // released before timers switched into THG
-						// need to double(posibly triple) tap here and
-						pti->triple_click_timeout=hw->ev_time+para->tap_time;
-						// do fist tap
-						xf86PostButtonEvent(pInfo->dev, FALSE, priv->timer_click_mask, TRUE, 0, 0);
-						xf86PostButtonEvent(pInfo->dev, FALSE, priv->timer_click_mask, FALSE, 0, 0);
-						// start next tap
-						xf86PostButtonEvent(pInfo->dev, FALSE, priv->timer_click_mask, TRUE, 0, 0);
-					case TS_THG: // released after THG or coming from TS_THG_WAIT
-						xf86PostButtonEvent(pInfo->dev, FALSE, priv->timer_click_mask, FALSE, 0, 0);
-						if(!pti->triple_click_timeout) priv->timer_click_mask=0;
-						priv->timer_time=1; // to be reset
-						pti->tap_state=TS_NONE;
-						//~ xf86PostButtonEvent(pInfo->dev, FALSE, priv->timer_click_mask, TRUE, 0, 0);
-						break;
-				}
-			}
-
-			// clean up
-
-			hwt->millis=0;
-			pti->touch_origin=TO_CLOSED;
-			pti->vert_area=0;
-			pti->hist_x=0;
-			pti->hist_y=0;
-			pti->tap_go=FALSE;
-			priv->go_scroll=FALSE;
-
-			// clear tap_start_time / cont. scroll ?
-			if(!priv->num_active_touches){
-				if(para->tap_anywhere) priv->tap_start_time=0;
-				if(priv->timer_y_scroll) priv->timer_time=20;
-			}
-
-			//~ xf86IDrvMsg(pInfo, X_INFO,"closed slot: %d\n",i);
-
-			continue;
-		}
-
-		x=hwt->x;
-		y=hwt->y;
-
-		// if we don't know X & Y than assume potential left button and go to next finger
-		if(!x || !y){
-			potential_click|=1;
-			continue;
-		}
-
-		// low pressure
-		if(hwt->z < para->finger_low) continue;
-
-		// At this point X, Y and Z are good
-
-		filter_jitter(priv, &x, &y, pti);
-		cba=current_button_area_new(para,x,y,pti);
-
-		//set touch origin, history and new_two_down if new touch
-		if(pti->touch_origin<TO_BTN_GAP){
-			pti->touch_origin=cba;
-
-			// set history so first deltas are 0's
-			pti->hist_x=x;
-			pti->hist_y=y;
-
-			// if two down check for scroll later
-			new_two_down=priv->num_active_touches;
-		}
-
-		//tap pressure reached handle THG mode
-		if(!pti->tap_go && !priv->go_scroll && hwt->z > para->tap_pressure){
-			pti->tap_go=TRUE;
-
-			// move delay if tap_anywhere is enabled
-			if(para->tap_anywhere && !priv->tap_start_time) priv->tap_start_time=hw->ev_time+120;
-
-			// turn off cont. scroll if any
-			if(priv->timer_y_scroll){
-				priv->timer_y_scroll=0;
-				priv->timer_time=1;
-			}
-
-			// set tap origin coords
-			pti->org_x=x;
-			pti->org_y=y;
-
-			// THG stuff
-			if(pti->tap_state==TS_WAIT){
-
-				int tto;
-				//~ =!pti->touch_origin?pti->touch_origin+para->tap_anywhere:pti->touch_origin;
-
-				// tap_anywhere THG move restrict
-				if(para->tap_anywhere && !pti->touch_origin &&
-					priv->timer_delta_x<para->tap_move && priv->timer_delta_y<para->tap_move){
-					tto=1;
-				}else tto=pti->touch_origin;
-
-
-				if(ffs(tto)==priv->timer_click_mask){ // <-- tap origin is the same
-					xf86PostButtonEvent(pInfo->dev, FALSE, priv->timer_click_mask, TRUE, 0, 0);
-					pti->tap_state=TS_THG_WAIT;
-					priv->timer_time=para->tap_time; // set timer to change to TS_THG if tap time expires
-
-				}else{ // <-- tap origing diferent
-					timerClick(pInfo, pti);
-					// set timer to reset
-					// priv->timer_time=1;
-				}
-			}
-		}
-
-		//scroll delta
-		priv->scroll_delta_x+=(x-pti->hist_x);
-		priv->scroll_delta_y+=(y-pti->hist_y);
-
-		// is move allowed
-		if(!pti->touch_origin || (!cba && priv->num_active_touches<2)){
-			// move deltas
-			dx+=(x-pti->hist_x);
-			dy+=(y-pti->hist_y);
-		}else if(cba>0){
-			// set potential_click if we are in a button area
-			potential_click|=cba;
-		}
-
-		// set history
-		pti->hist_x=x;
-		pti->hist_y=y;
-	}
-
-	if(hw->left){
-		// handle clicks ----
-
-		buttons=priv->lastButtons;
-
-		// ziro potential_click if priv->lastButtons
-		potential_click&=-(priv->lastButtons==0);
-
-		// buttons = potential_click if lastButtons==0
-		buttons|=potential_click;
-
-	}else if(priv->go_scroll ||
-		(new_two_down==2 &&
-		(priv->ns_info[0].vert_area==priv->ns_info[1].vert_area ||
-		(abs(priv->ns_info[0].hist_x-priv->ns_info[1].hist_x)<para->finger_radius &&
-		abs(priv->ns_info[0].hist_y-priv->ns_info[1].hist_y)<para->finger_radius)))){
-		/* Handle Scroll IF
-		* - already in the scroll mode
-		* - new two finger touch and
-		* - both fingers are in the same area or fingers are close together
-		* */
-
-		// if syndaemon allows scroll than scroll
-		if(para->touchpad_off!=TOUCHPAD_TAP_OFF){
-			int abs_sdy=abs(priv->scroll_delta_y);
-
-			// scroll either y OR x
-			temp=(abs_sdy-abs(priv->scroll_delta_x))>>INT_SHIFT;
-			priv->scroll_delta_x&=temp;
-			priv->scroll_delta_y&=~temp;
-
-
-			//apply scroll Endable/Disable settings
-			if(!para->scroll_twofinger_vert) priv->scroll_delta_y=0;
-			if(!para->scroll_twofinger_horiz) priv->scroll_delta_x=0;
-
-			post_scroll_events(pInfo);
-
-			// cont. scroll if sdy>150
-			priv->timer_y_scroll=priv->scroll_delta_y&((150-abs_sdy)>>INT_SHIFT);
-		}
-
-		priv->go_scroll=TRUE;
-
-		// no move if scroll or attempt to scroll when TOUCHPAD_TAP_OFF
-		temp=1;
-	}
-
-
-	// reuse x and y vars
-	x=abs(dx);
-	y=abs(dy);
-
-	// no move if to much delta
-	temp|=(x>400)|(y>400);
-	// no motion if button was just clicked
-	temp|=(hw->ev_time<priv->btn_up_time);
-
-	// deal with tap_anywhere
-	if(para->tap_anywhere && priv->tap_start_time>1){
-		// stabilize tap - cancel move only if deltas are small and within the delay time (120ms)
-		if (x>para->hyst_x || y>para->hyst_y) priv->tap_start_time=1;
-		else if(hw->ev_time<priv->tap_start_time) temp=1;
-		else priv->tap_start_time=1;
-	}
-	// post motion ----------
-    if ((dx || dy) && !temp){
-
-		// TGH stuff
-		if((priv->ns_info[0].tap_state|priv->ns_info[1].tap_state)==1){
-			priv->timer_delta_x+=dx;
-			priv->timer_delta_y+=dy;
-		}
-
-		xf86PostMotionEvent(pInfo->dev, 0, 0, 2, dx, dy);
-	}
-
-	// post clicks ----------
-    change = buttons ^ priv->lastButtons;
-    while (change) {
-        id = ffs(change);       /* number of first set bit 1..32 is returned */
-        change &= ~(1 << (id - 1));
-        xf86PostButtonEvent(pInfo->dev, FALSE, id, (buttons & (1 << (id - 1))), 0, 0);
-    }
 
-    // Save old buttons
-    priv->lastButtons = buttons;
+    priv->gs.last_key_time = priv->typing.last_key_time;
+    /* a frame cut short by SYN_DROPPED has no timestamp of its own */
+    priv->latency.frame_time = hw->ev_time;
+    priv->latency.pending = !hw->dropped;
+    GestureHandleState(&priv->gs, priv->synpara, hw);
+    priv->latency.pending = FALSE;
+
+    if (priv->monitor.interval)
+        MonitorSnapshot(priv, hw, priv->gs.lastButtons);
+    if (priv->shm)
+        SynapticsShmUpdate(pInfo, hw, priv->gs.lastButtons);
 }
 
 static int
@@ -1569,8 +1346,8 @@ QueryHardware(InputInfoPtr pInfo)
 static void
 ScaleCoordinates(SynapticsPrivate * priv, struct SynapticsHwState *hw)
 {
-    int xCenter = (priv->synpara.left_edge + priv->synpara.right_edge) / 2;
-    int yCenter = (priv->synpara.top_edge + priv->synpara.bottom_edge) / 2;
+    int xCenter = (priv->synpara->left_edge + priv->synpara->right_edge) / 2;
+    int yCenter = (priv->synpara->top_edge + priv->synpara->bottom_edge) / 2;
 
     //~ hw->x = (hw->x - xCenter) * priv->horiz_coeff + xCenter;
     //~ hw->y = (hw->y - yCenter) * priv->vert_coeff + yCenter;
@@ -1579,8 +1356,8 @@ ScaleCoordinates(SynapticsPrivate * priv, struct SynapticsHwState *hw)
 void
 CalculateScalingCoeffs(SynapticsPrivate * priv)
 {
-    int vertRes = priv->synpara.resolution_vert;
-    int horizRes = priv->synpara.resolution_horiz;
+    int vertRes = priv->synpara->resolution_vert;
+    int horizRes = priv->synpara->resolution_horiz;
 
     if ((horizRes > vertRes) && (horizRes > 0)) {
         priv->horiz_coeff = vertRes / (double) horizRes;
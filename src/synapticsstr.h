@@ -23,6 +23,10 @@
 #define _SYNAPTICSSTR_H_
 
 #include "synproto.h"
+#include "typing.h"
+#include "shm.h"
+#include "clock.h"
+#include "synaptics-properties.h"
 
 #if GET_ABI_MAJOR(ABI_XINPUT_VERSION) < 18
 #define LogMessageVerbSigSafe xf86MsgVerb
@@ -53,15 +57,7 @@
  *****************************************************************************/
 #define SYN_MAX_BUTTONS 12      /* Max number of mouse buttons */
 
-#define MAX_TP 2 /* Max track points*/
-
-static const int INT_SHIFT = sizeof(int)*CHAR_BIT-1;
-
-enum OffState {
-    TOUCHPAD_ON = 0,
-    TOUCHPAD_OFF = 1,
-    TOUCHPAD_TAP_OFF = 2,
-};
+#define SYN_MAX_PROFILES 8      /* Max number of named parameter profiles */
 
 typedef struct _SynapticsTouchAxis {
     const char *label;
@@ -80,95 +76,70 @@ enum TouchpadModel {
     MODEL_UNIBODY_MACBOOK
 };
 
-enum TouchOrigin{
-	TO_CLOSED=-2,
-	TO_BTN_GAP=-1,
-	TO_NO_CLICK=0,
-	TO_LEFT_CLICK=1,
-	TO_MIDDLE_CLICK=2,
-	TO_RIGHT_CLICK=4
+/* Touchpad state published for synclient -m */
+struct SynapticsMonitor {
+    int interval;               /* ms between updates, 0 if nobody monitors */
+    CARD32 expires;             /* end of the lease */
+    OsTimerPtr timer;           /* publishes state, runs in the main thread */
+    Bool dirty;                 /* state changed since the last update */
+    INT32 state[SYNAPTICS_MON_COUNT];   /* written by HandleState */
 };
 
-enum VertArea{
-	VA_NO,		// not defined
-	VA_TOP,		// top button area
-	VA_MID,		// no click area
-	VA_BOT		// buttom bnt area
+/* Frame latency histogram, see SYNAPTICS_PROP_LATENCY */
+struct SynapticsLatency {
+    Bool pending;               /* HandleState runs and hasn't posted yet */
+    CARD32 frame_time;          /* kernel timestamp of that frame */
+    CARD32 hist[SYNAPTICS_LAT_COUNT];   /* written by the post functions */
 };
 
-enum TapState{
-	TS_NONE,
-	TS_WAIT,		// waiting for to fire click - timer is ON
-	TS_THG_WAIT,		// button down fired - timer is ON to switch state to TS_THG
-	TS_THG			// we are in THG mode - timer is OFF
+/* The atoms of the device properties, see properties.c */
+struct SynapticsPropAtoms {
+    Atom float_type;
+    Atom finger;
+    Atom tap_time;
+    Atom tap_move;
+    Atom clickpad;
+    Atom scrolldist;
+    Atom scrolltwofinger;
+    Atom speed;
+    Atom off;
+    Atom pressuremotion;
+    Atom pressuremotion_factor;
+    Atom grab;
+    Atom capabilities;
+    Atom resolution;
+    Atom noise_cancellation;
+    Atom product_id;
+    Atom device_node;
+    Atom bottom_buttons;
+    Atom top_buttons;
+    Atom scroll_twofinger_finger_size;
+    Atom tap_extras;
+    Atom typing_timeout;
+    Atom param_block;
+    Atom active_profile;
+    Atom profile_names;
+    Atom monitor_control;
+    Atom monitor_state;
+    Atom latency;
+    Atom counters;
 };
 
-struct ns_inf{ // perfinger tracking info
-	int hist_x;
-	int hist_y;
-	int org_x;		// touch origin x
-	int org_y;		// touch origin y
-	CARD32 triple_click_timeout;
-    int hyst_center_x;          /* center x of hysteresis */
-    int hyst_center_y;          /* center y of hysteresis */
-	enum TouchOrigin touch_origin;
-	int vert_area;				// for scroll stuff;
-	enum TapState tap_state;
-	Bool tap_go;				// tap pressure breached
+/* The X server implementation of struct SynapticsClock */
+struct XClock {
+    struct SynapticsClock clock;
+    OsTimerPtr timer;
+    ClockTimerFunc func;
+    void *arg;
 };
 
-typedef struct _SynapticsParameters {
-    int finger_low, finger_high; //, finger_press;  /* finger detection values in Z-values */
-    int tap_time;
-    int tap_move;               /* max. tapping time and movement in packets and coord. */
-    Bool clickpad;              /* Device is a has integrated buttons */
-    int scroll_dist_vert;       /* Scrolling distance in absolute coordinates */
-    int scroll_dist_horiz;      /* Scrolling distance in absolute coordinates */
-    Bool scroll_twofinger_vert; /* Enable/disable vertical two-finger scrolling */
-    Bool scroll_twofinger_horiz;        /* Enable/disable horizontal two-finger scrolling */
-    double min_speed, max_speed, accl;  /* movement parameters */
-    int touchpad_off;           /* Switches the touchpad off
-                                 * 0 : Not off
-                                 * 1 : Off
-                                 * 2 : Only tapping and scrolling off
-                                 */
-    int press_motion_min_z;     /* finger pressure at which minimum pressure motion factor is applied */
-    int press_motion_max_z;     /* finger pressure at which maximum pressure motion factor is applied */
-    double press_motion_min_factor;     /* factor applied on speed when finger pressure is at minimum */
-    double press_motion_max_factor;     /* factor applied on speed when finger pressure is at maximum */
-    Bool grab_event_device;     /* grab event device for exclusive use? */
-    unsigned int resolution_horiz;      /* horizontal resolution of touchpad in units/mm */
-    unsigned int resolution_vert;       /* vertical resolution of touchpad in units/mm */
-    int hyst_x, hyst_y;         /* x and y width of hysteresis box */
-
-    int bottom_buttons_height;				// default = 25%
-	int bottom_buttons_sep_pos;				// default = 50%
-	int bottom_buttons_sep_width;			// default = 2%
-	// calculated
-    int no_button_max_y;		// Bottom edge of no button area
-    int bottom_left_btn_rx;		// right edge of bottom left button
-    int bottom_right_btn_lx;	// left edge of bottom right button
-
-	int top_buttons_height; 				// default = 15%
-	int top_buttons_middle_width; 			// default = 16%
-	// calculated
-    int no_button_min_y;		// Bottom edge of no button area
-	int top_mid_lx;				// left edge of top middle button
-	int top_mid_rx;				// right edge of top middle button
-
-	int scroll_twofinger_finger_size; 		//Finger Box Size, default = 18%
-	// calculated
-    int finger_radius;			// size of finger box for scrolling...
-
-	int tap_pressure; 						// default = 50;
-	int tap_anywhere;						// 0-disable, 1 - enable
-	int tap_hold;							// Tap Hold Gesture - default timeOut=150 in ms/0-disable
-
-} SynapticsParameters;
-
 struct _SynapticsPrivateRec {
-    SynapticsParameters synpara;        /* Default parameter settings, read from
-                                           the X config file */
+    SynapticsParameters *synpara;       /* Active parameter settings, points
+                                           into profiles */
+    SynapticsParameters profiles[SYN_MAX_PROFILES];     /* 0 is the default
+                                                           from the X config file */
+    char *profile_names[SYN_MAX_PROFILES];
+    int num_profiles;
     struct SynapticsProtocolOperations *proto_ops;
     void *proto_data;           /* protocol-specific data */
 
@@ -180,19 +151,13 @@ struct _SynapticsPrivateRec {
 
     struct SynapticsHwState *local_hw_state;    /* used in place of local hw state variables */
 
-    int hyst_center_x;          /* center x of hysteresis */
-    int hyst_center_y;          /* center y of hysteresis */
-
-    int scroll_delta_x;         /* accumulated horiz scroll delta */
-	int scroll_delta_y;         /* accumulated vert scroll delta */
+    struct GestureState gs;     /* the gesture engine */
 
 #ifndef NO_DRIVER_SCALING
     double horiz_coeff;         /* normalization factor for x coordintes */
     double vert_coeff;          /* normalization factor for y coordintes */
 #endif
 
-	int lastButtons;
-
     int minx, maxx, miny, maxy; /* min/max dimensions as detected */
     int minp, maxp, minw, maxw; /* min/max pressure and finger width as detected */
     int resx, resy;             /* resolution of coordinates as detected in units/mm */
@@ -214,23 +179,24 @@ struct _SynapticsPrivateRec {
     int num_mt_axes;            /* Number of multitouch axes other than X, Y */
     SynapticsTouchAxisRec *touch_axes;  /* Touch axis information other than X, Y */
 
-    int num_active_touches;     /* Number of active touches on device */
+    struct SynapticsPropAtoms atoms;    /* device properties */
+    Bool updating_properties;   /* driver is re-publishing its own properties */
 
-	struct ns_inf *ns_info;
-	CARD32 btn_up_time; 				// when button was released;
-	Bool go_scroll;
+    struct SynapticsClock *clock;       /* time source and engine timer */
+    struct XClock xclock;               /* the X server clock */
 
-    OsTimerPtr timer;           /* for up/down-button repeat, tap processing, etc */
-    CARD32 timer_time;
-    int timer_click_mask;
-    Bool timer_click_finish;
+    const char *typing_keyboard;        /* TypingKeyboard option, NULL if unset */
+    struct TypingMonitor typing;        /* keyboards watched for typing */
 
-    int timer_delta_x;			// deltas while waiting to tap
-    int timer_delta_y;
+    struct SynapticsMonitor monitor;
+    struct SynapticsLatency latency;
 
-    int timer_y_scroll;			// cont y scroll
-
-    CARD32 tap_start_time;		// let's call this tap_anywhere stabilizer timeout
+    Bool use_shm;               /* SharedMemory option */
+    struct SynapticsShm *shm;   /* NULL unless use_shm and the device is init */
 };
 
+extern void UpdateDerivedParameters(SynapticsPrivate *priv,
+                                    SynapticsParameters *pars,
+                                    unsigned int dirty);
+
 #endif                          /* _SYNAPTICSSTR_H_ */
@@ -63,51 +63,3 @@ SynapticsHwStateFree(struct SynapticsHwState **hw)
     free(*hw);
     *hw = NULL;
 }
-
-void
-SynapticsCopyHwState(struct SynapticsHwState *dst,
-                     const struct SynapticsHwState *src)
-{
-	dst->left=src->left;
-	dst->ev_time=src->ev_time;
-    memcpy(dst->touches, src->touches, MAX_TP * sizeof(struct TouchData));
-
-}
-
-void
-SynapticsResetHwState(struct SynapticsHwState *hw)
-{
-    struct TouchData *hwt = hw->touches;
-    int i;
-	hw->left=FALSE;
-	hw->ev_time=0;
-	for(i=0;i<MAX_TP;i++){
-		hwt->slot_state=SLOTSTATE_EMPTY;
-		hwt->x=0;
-		hwt->y=0;
-		hwt->z=0;
-		hwt->millis=0;
-		hwt++;
-	}
-}
-
-void
-SynapticsResetTouchHwState(struct SynapticsHwState *hw, Bool set_slot_empty)
-{
-
-	struct TouchData *hwt = hw->touches;
-	int i;
-    for (i = 0; i < MAX_TP; i++) {
-        switch (hwt->slot_state){
-        case SLOTSTATE_OPEN:
-        case SLOTSTATE_OPEN_EMPTY:
-        case SLOTSTATE_UPDATE:
-            hwt->slot_state = set_slot_empty ? SLOTSTATE_EMPTY : SLOTSTATE_OPEN_EMPTY;
-            break;
-        default:
-            hwt->slot_state = SLOTSTATE_EMPTY;
-            break;
-        }
-        hwt++;
-    }
-}
@@ -49,6 +49,8 @@
 #include <xf86Xinput.h>
 #include <xisb.h>
 
+#include "gesture.h"
+
 #ifndef XI86_SERVER_FD
 #define XI86_SERVER_FD 0x20
 #endif
@@ -56,34 +58,10 @@
 struct _SynapticsPrivateRec;
 typedef struct _SynapticsPrivateRec SynapticsPrivate;
 
-enum SynapticsSlotState {
-    SLOTSTATE_EMPTY = 0,        /* no slot in this cycle */
-    SLOTSTATE_OPEN,             /* tracking ID received */
-    SLOTSTATE_CLOSE,            /* tracking ID -1 received */
-    SLOTSTATE_OPEN_EMPTY,       /* previously had tracking id, no events in this read cycle */
-    SLOTSTATE_UPDATE,           /* had tracking id, other events in this cycle */
-};
-
 /* used to mark emulated hw button state */
 #define BTN_EMULATED_FLAG 0x80
 
 
-struct TouchData{
-	enum SynapticsSlotState slot_state;
-	int x;
-	int y;
-	int z;
-	CARD32 millis;              /* Timestamp in milliseconds */
-};
-/*
- * A structure to describe the state of the touchpad hardware (buttons and pad)
- */
-struct SynapticsHwState {
-	struct TouchData *touches;
-    CARD32 ev_time;
-    Bool left;
-};
-
 struct CommData {
     XISBuffer *buffer;
     unsigned char protoBuf[6];  /* Buffer for Packet */
@@ -116,6 +94,7 @@ struct SynapticsProtocolOperations {
 //~ #endif                          /* BUILD_PS2COMM */
 #ifdef BUILD_EVENTCOMM
 extern struct SynapticsProtocolOperations event_proto_operations;
+extern struct SynapticsProtocolOperations replay_proto_operations;
 #endif                          /* BUILD_EVENTCOMM */
 //~ #ifdef BUILD_PSMCOMM
 //~ extern struct SynapticsProtocolOperations psm_proto_operations;
@@ -123,11 +102,6 @@ extern struct SynapticsProtocolOperations event_proto_operations;
 
 extern struct SynapticsHwState *SynapticsHwStateAlloc(SynapticsPrivate * priv);
 extern void SynapticsHwStateFree(struct SynapticsHwState **hw);
-extern void SynapticsCopyHwState(struct SynapticsHwState *dst,
-                                 const struct SynapticsHwState *src);
-extern void SynapticsResetHwState(struct SynapticsHwState *hw);
-extern void SynapticsResetTouchHwState(struct SynapticsHwState *hw,
-                                       Bool set_slot_empty);
 
 extern Bool SynapticsIsSoftButtonAreasValid(int *values);
 
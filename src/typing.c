@@ -0,0 +1,230 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <xorg-server.h>
+#include "typing.h"
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/input.h>
+#include "synproto.h"
+#include "synapticsstr.h"
+#include <xf86.h>
+
+#define DEV_INPUT_DIR "/dev/input"
+
+#define SYSCALL(call) while (((call) == -1) && (errno == EINTR))
+
+#define NBITS(x) ((((x) - 1) / (sizeof(long) * 8)) + 1)
+#define TEST_BIT(bit, array) \
+    ((array[(bit) / (sizeof(long) * 8)] >> ((bit) % (sizeof(long) * 8))) & 1)
+
+static Bool
+is_keyboard(int fd)
+{
+    unsigned long evbits[NBITS(EV_MAX + 1)] = { 0 };
+    unsigned long keybits[NBITS(KEY_MAX + 1)] = { 0 };
+
+    if (ioctl(fd, EVIOCGBIT(0, sizeof(evbits)), evbits) < 0 ||
+        !TEST_BIT(EV_KEY, evbits))
+        return FALSE;
+
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keybits)), keybits) < 0)
+        return FALSE;
+
+    return TEST_BIT(KEY_A, keybits) && TEST_BIT(KEY_Z, keybits) &&
+        TEST_BIT(KEY_SPACE, keybits) && !TEST_BIT(BTN_TOUCH, keybits);
+}
+
+/* Modifiers are held down for Ctrl+click and friends, they don't count as
+ * typing. */
+static Bool
+is_modifier(int code)
+{
+    switch (code) {
+    case KEY_LEFTCTRL:
+    case KEY_RIGHTCTRL:
+    case KEY_LEFTSHIFT:
+    case KEY_RIGHTSHIFT:
+    case KEY_LEFTALT:
+    case KEY_RIGHTALT:
+    case KEY_LEFTMETA:
+    case KEY_RIGHTMETA:
+    case KEY_CAPSLOCK:
+    case KEY_FN:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+static void
+TypingReadInput(int fd, pointer data)
+{
+    InputInfoPtr pInfo = data;
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    struct TypingMonitor *tm = &priv->typing;
+    struct input_event ev[32];
+    int i, k, n;
+
+    for (k = 0; k < tm->num_keyboards; k++)
+        if (tm->fd[k] == fd)
+            break;
+    if (k == tm->num_keyboards)
+        return;
+
+    while ((n = read(fd, ev, sizeof(ev))) > 0) {
+        for (i = 0; i < n / sizeof(ev[0]); i++) {
+            if (ev[i].type != EV_KEY || ev[i].value == 0 ||
+                is_modifier(ev[i].code))
+                continue;
+
+            /* same clock as the touchpad's hw->ev_time */
+            if (tm->monotonic[k])
+                tm->last_key_time = 1000 * ev[i].time.tv_sec +
+                    ev[i].time.tv_usec / 1000;
+            else
+                tm->last_key_time = priv->clock->now(priv->clock);
+        }
+    }
+
+    if (n < 0 && errno == ENODEV) {
+        xf86IDrvMsg(pInfo, X_INFO, "typing keyboard removed\n");
+        xf86RemoveInputHandler(tm->handler[k]);
+        close(fd);
+        tm->num_keyboards--;
+        tm->fd[k] = tm->fd[tm->num_keyboards];
+        tm->handler[k] = tm->handler[tm->num_keyboards];
+        tm->monotonic[k] = tm->monotonic[tm->num_keyboards];
+    }
+}
+
+static Bool
+TypingAddKeyboard(InputInfoPtr pInfo, const char *path)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    struct TypingMonitor *tm = &priv->typing;
+    int fd;
+
+    if (tm->num_keyboards == TYPING_MAX_KEYBOARDS)
+        return FALSE;
+
+    /* read-only and never grabbed, the keyboard driver keeps working */
+    SYSCALL(fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC));
+    if (fd < 0)
+        return FALSE;
+
+    if (!is_keyboard(fd)) {
+        close(fd);
+        return FALSE;
+    }
+
+    tm->fd[tm->num_keyboards] = fd;
+#ifdef EVIOCSCLOCKID
+    {
+        int clk = CLOCK_MONOTONIC;
+
+        tm->monotonic[tm->num_keyboards] =
+            ioctl(fd, EVIOCSCLOCKID, &clk) == 0;
+    }
+#else
+    tm->monotonic[tm->num_keyboards] = FALSE;
+#endif
+    tm->handler[tm->num_keyboards] =
+        xf86AddInputHandler(fd, TypingReadInput, pInfo);
+    if (!tm->handler[tm->num_keyboards]) {
+        close(fd);
+        return FALSE;
+    }
+    tm->num_keyboards++;
+
+    xf86IDrvMsg(pInfo, X_CONFIG, "typing keyboard %s\n", path);
+    return TRUE;
+}
+
+/*
+ * Start watching the keyboard given by the TypingKeyboard option, a device
+ * path or "auto" for all keyboards found in /dev/input.
+ */
+void
+TypingMonitorOn(InputInfoPtr pInfo, const char *keyboard)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    DIR *dir;
+    struct dirent *entry;
+
+    priv->typing.num_keyboards = 0;
+    priv->typing.last_key_time = 0;
+
+    if (!keyboard)
+        return;
+
+    if (strcasecmp(keyboard, "auto") != 0) {
+        if (!TypingAddKeyboard(pInfo, keyboard))
+            xf86IDrvMsg(pInfo, X_WARNING,
+                        "cannot use %s as typing keyboard\n", keyboard);
+        return;
+    }
+
+    dir = opendir(DEV_INPUT_DIR);
+    if (!dir)
+        return;
+
+    while ((entry = readdir(dir))) {
+        char path[PATH_MAX];
+
+        if (strncmp(entry->d_name, "event", 5) != 0)
+            continue;
+
+        snprintf(path, sizeof(path), "%s/%s", DEV_INPUT_DIR, entry->d_name);
+        TypingAddKeyboard(pInfo, path);
+    }
+    closedir(dir);
+
+    if (!priv->typing.num_keyboards)
+        xf86IDrvMsg(pInfo, X_WARNING, "no typing keyboard found\n");
+}
+
+void
+TypingMonitorOff(InputInfoPtr pInfo)
+{
+    SynapticsPrivate *priv = (SynapticsPrivate *) pInfo->private;
+    struct TypingMonitor *tm = &priv->typing;
+    int i;
+
+    for (i = 0; i < tm->num_keyboards; i++) {
+        xf86RemoveInputHandler(tm->handler[i]);
+        close(tm->fd[i]);
+    }
+    tm->num_keyboards = 0;
+}
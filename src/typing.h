@@ -0,0 +1,51 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _TYPING_H_
+#define _TYPING_H_
+
+#include <xorg-server.h>
+#include <xf86Xinput.h>
+
+/* for TypingKeyboard "auto" */
+#define TYPING_MAX_KEYBOARDS 4
+
+/*
+ * Keyboards watched for the in-driver disable-while-typing. The driver reads
+ * them directly, so the touchpad reacts to a key without waiting for a
+ * client (syndaemon) to round trip through the server.
+ */
+struct TypingMonitor {
+    int fd[TYPING_MAX_KEYBOARDS];
+    pointer handler[TYPING_MAX_KEYBOARDS];
+    Bool monotonic[TYPING_MAX_KEYBOARDS];       /* kernel timestamps are
+                                                   CLOCK_MONOTONIC */
+    int num_keyboards;
+    CARD32 last_key_time;       /* time of the last non-modifier key press,
+                                   0 if none yet */
+};
+
+extern void TypingMonitorOn(InputInfoPtr pInfo, const char *keyboard);
+extern void TypingMonitorOff(InputInfoPtr pInfo);
+
+#endif                          /* _TYPING_H_ */
@@ -0,0 +1,112 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "workers.h"
+
+#define MAX_WORKERS 256
+
+struct Work {
+    pthread_mutex_t lock;
+    size_t next;                /* first item nobody took yet */
+    size_t count;
+    WorkFunc func;
+    void *data;
+};
+
+static void *
+worker(void *arg)
+{
+    struct Work *work = arg;
+
+    for (;;) {
+        size_t index;
+
+        pthread_mutex_lock(&work->lock);
+        index = work->next;
+        if (index < work->count)
+            work->next++;
+        pthread_mutex_unlock(&work->lock);
+
+        if (index >= work->count)
+            break;
+        work->func(work->data, index);
+    }
+
+    return NULL;
+}
+
+/**
+ * @return The number of online processors, at least 1.
+ */
+int
+WorkersDefault(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n < 1)
+        return 1;
+    return n < MAX_WORKERS ? n : MAX_WORKERS;
+}
+
+/**
+ * Call func(data, index) for every index below count on up to workers
+ * threads, the calling thread being one of them. Returns when all items
+ * are done. If threads can't be created the items run on fewer.
+ */
+void
+WorkersRun(size_t count, int workers, WorkFunc func, void *data)
+{
+    pthread_t threads[MAX_WORKERS];
+    struct Work work;
+    int i, started = 0;
+
+    if (workers > MAX_WORKERS)
+        workers = MAX_WORKERS;
+    if ((size_t) workers > count)
+        workers = count;
+
+    pthread_mutex_init(&work.lock, NULL);
+    work.next = 0;
+    work.count = count;
+    work.func = func;
+    work.data = data;
+
+    for (i = 1; i < workers; i++) {
+        if (pthread_create(&threads[started], NULL, worker, &work))
+            break;
+        started++;
+    }
+
+    worker(&work);
+
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&work.lock);
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * fuzz-frames: libFuzzer target for the evdev frame decoding and the
+ * gesture engine.
+ *
+ * Build it with clang and run it from the test directory:
+ *
+ *   make fuzz-frames CC=clang
+ *   ./fuzz-frames -max_len=4096 fuzz-corpus
+ *
+ * or just make fuzz CC=clang, which keeps what it finds in fuzz-corpus.
+ *
+ * The input is turned into evdev events the way a touchpad could send
+ * them, and the way it shouldn't: slots out of range, touches ending that
+ * never started, tracking IDs repeated, SYN_DROPPED anywhere, time going
+ * backwards. They go through a FramePlayer and after every frame these
+ * must hold:
+ *
+ * - num_active_touches matches the tracked slots, 0 to MAX_TP
+ * - the physical button mask only has button bits, none while BTN_LEFT
+ *   is up, and the engine only posts buttons 1 to 3
+ * - the engine timer never expires before the current time
+ *
+ * At the end every touch is lifted, the button released and the timers run
+ * out; no button may be left pressed then.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <linux/input.h>
+
+#include "player.h"
+
+#define START_TIME      100000
+#define ALL_BUTTONS     0x7
+
+struct Fuzz {
+    unsigned int pressed;       /* buttons down as far as the server knows */
+};
+
+static void
+fail(const char *what)
+{
+    fprintf(stderr, "invariant violated: %s\n", what);
+    abort();
+}
+
+static void
+fuzz_post_motion(void *data, int dx, int dy)
+{
+}
+
+/* a tap may press the button a click already holds, the server ignores
+   that, so only track the state the way it does */
+static void
+fuzz_post_button(void *data, int button, Bool is_down)
+{
+    struct Fuzz *fuzz = data;
+
+    if (button < 1 || button > 3)
+        fail("button out of range");
+
+    if (is_down)
+        fuzz->pressed |= 1 << (button - 1);
+    else
+        fuzz->pressed &= ~(1 << (button - 1));
+}
+
+static void
+fuzz_post_scroll(void *data, int dx, int dy)
+{
+}
+
+static const struct GestureSink fuzz_sink = {
+    fuzz_post_motion,
+    fuzz_post_button,
+    fuzz_post_scroll,
+    NULL
+};
+
+static void
+check_frame(const struct FramePlayer *player)
+{
+    const struct GestureState *gs = &player->gs;
+    int i, active = 0;
+
+    for (i = 0; i < MAX_TP; i++) {
+        switch (player->acc.touches[i].slot_state) {
+        case SLOTSTATE_OPEN:
+        case SLOTSTATE_OPEN_EMPTY:
+        case SLOTSTATE_UPDATE:
+            active++;
+            break;
+        default:
+            break;
+        }
+    }
+    if (gs->num_active_touches != active)
+        fail("num_active_touches doesn't match the slots");
+    if (gs->num_active_touches < 0 || gs->num_active_touches > MAX_TP)
+        fail("num_active_touches out of range");
+
+    if (gs->lastButtons & ~ALL_BUTTONS)
+        fail("unknown bits in the button mask");
+    if (gs->lastButtons && !player->frame.left)
+        fail("buttons down while BTN_LEFT is up");
+}
+
+static void
+check_timer(const struct FramePlayer *player)
+{
+    if (player->sim.armed && (INT32) (player->sim.expires - player->sim.now) < 0)
+        fail("timer armed in the past");
+}
+
+static void
+feed(struct FramePlayer *player, unsigned int type, unsigned int code,
+     int value, CARD32 millis)
+{
+    if (PlayerFeed(player, type, code, value, millis))
+        check_frame(player);
+    check_timer(player);
+}
+
+/**
+ * Decode one 4 byte event: the low 3 bits of the first byte select the
+ * event, the rest of it is the time since the previous event in ms.
+ */
+static void
+feed_bytes(struct FramePlayer *player, const uint8_t *b, CARD32 *millis)
+{
+    int value = (int16_t) (b[1] << 8 | b[2]);
+
+    *millis += b[0] >> 3;
+
+    switch (b[0] & 7) {
+    case 0:
+        feed(player, EV_ABS, ABS_MT_SLOT, (int8_t) b[3] >> 5, *millis);
+        break;
+    case 1:
+        feed(player, EV_ABS, ABS_MT_TRACKING_ID, (int8_t) b[3] < 0 ? -1 : b[3],
+             *millis);
+        break;
+    case 2:
+        feed(player, EV_ABS, ABS_MT_POSITION_X, value, *millis);
+        break;
+    case 3:
+        feed(player, EV_ABS, ABS_MT_POSITION_Y, value, *millis);
+        break;
+    case 4:
+        feed(player, EV_ABS, ABS_MT_PRESSURE, b[3], *millis);
+        break;
+    case 5:
+        feed(player, EV_KEY, BTN_LEFT, b[3] & 1, *millis);
+        break;
+    case 6:
+        feed(player, EV_SYN, SYN_REPORT, 0, *millis);
+        break;
+    case 7:
+        switch (b[3] & 3) {
+        case 0:
+            feed(player, EV_SYN, SYN_DROPPED, 0, *millis);
+            break;
+        case 1:
+            /* timestamps aren't guaranteed to be monotonic */
+            *millis -= b[1];
+            break;
+        default:
+            /* anything else the kernel might send */
+            feed(player, b[3] >> 6, b[1], value, *millis);
+            break;
+        }
+        break;
+    }
+}
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    SynapticsParameters para;
+    struct RecordDevice dev;
+    struct FramePlayer player;
+    struct Fuzz fuzz = { 0 };
+    CARD32 millis = START_TIME;
+    uint8_t config;
+    int i;
+
+    if (size < 1)
+        return 0;
+
+    /* a T440 like clickpad, the first byte picks the options that change
+       the engine's paths */
+    memset(&dev, 0, sizeof(dev));
+    dev.minx = 1266;
+    dev.maxx = 5676;
+    dev.miny = 1096;
+    dev.maxy = 4758;
+    dev.resx = 40;
+    dev.resy = 68;
+    dev.hyst_x = -1;
+    dev.hyst_y = -1;
+    dev.has_pressure = TRUE;
+    dev.maxp = 255;
+    dev.has_left = TRUE;
+    dev.clickpad = TRUE;
+    dev.max_touches = 2;
+    PlayerParameters(&para, &dev);
+
+    config = data[0];
+    para.tap_anywhere = config & 1;
+    para.scroll_twofinger_vert = (config >> 1) & 1;
+    para.scroll_twofinger_horiz = (config >> 1) & 1;
+    if (config & 4)
+        para.tap_hold = 0;
+    para.touchpad_off = ((config >> 3) & 3) % 3;
+
+    PlayerInit(&player, &para, millis, &fuzz_sink, &fuzz);
+    if (config & 0x20)
+        player.gs.last_key_time = millis;
+
+    for (data++, size--; size >= 4; data += 4, size -= 4)
+        feed_bytes(&player, data, &millis);
+
+    /* lift everything well after the last event and let the timers run */
+    millis += 1000;
+    for (i = 0; i < MAX_TP; i++) {
+        feed(&player, EV_ABS, ABS_MT_SLOT, i, millis);
+        feed(&player, EV_ABS, ABS_MT_TRACKING_ID, -1, millis);
+    }
+    feed(&player, EV_KEY, BTN_LEFT, 0, millis);
+    feed(&player, EV_SYN, SYN_REPORT, 0, millis);
+    PlayerFinish(&player, 10000);
+
+    if (player.gs.num_active_touches)
+        fail("touches left after lifting all");
+    if (fuzz.pressed)
+        fail("button left pressed");
+
+    return 0;
+}
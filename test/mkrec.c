@@ -0,0 +1,277 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * mkrec: turn a test script into a touchpad recording.
+ *
+ * The corpus is kept as text so changes to it can be reviewed. A script
+ * describes the device, then lists one frame per line:
+ *
+ *   # comment
+ *   x 1266 5676 40          ABS_X and ABS_MT_POSITION_X: min max res [fuzz]
+ *   y 1096 4758 68          the same for y
+ *   pressure 0 255          ABS_PRESSURE and ABS_MT_PRESSURE
+ *   slots 2                 touch slots
+ *   clickpad                INPUT_PROP_BUTTONPAD
+ *   option Name value       driver option, for replay-test and synbench -s
+ *
+ *   1000 slot 0 id 1 x 2000 y 3000 p 60
+ *   1012 x 2010 p 62
+ *   1024 left 1 dropped
+ *
+ * A frame line starts with its time in ms, followed by name value pairs:
+ * slot, id, x, y, p (ABS_MT_SLOT, _TRACKING_ID, _POSITION_X, _POSITION_Y,
+ * _PRESSURE) and left (BTN_LEFT). The frame ends with a SYN_REPORT, or
+ * with a SYN_DROPPED if the line ends with "dropped".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <linux/input.h>
+
+#include "synaptics-record.h"
+
+#ifndef INPUT_PROP_BUTTONPAD
+#define INPUT_PROP_BUTTONPAD 0x02
+#endif
+
+static const struct {
+    const char *name;
+    int type;
+    int code;
+} frame_codes[] = {
+    { "slot", EV_ABS, ABS_MT_SLOT },
+    { "id", EV_ABS, ABS_MT_TRACKING_ID },
+    { "x", EV_ABS, ABS_MT_POSITION_X },
+    { "y", EV_ABS, ABS_MT_POSITION_Y },
+    { "p", EV_ABS, ABS_MT_PRESSURE },
+    { "left", EV_KEY, BTN_LEFT },
+};
+
+static const char *script;
+static const char *recording;
+static int lineno;
+
+/* a half written recording must not look up to date to make */
+static void
+die(const char *msg)
+{
+    fprintf(stderr, "%s:%d: %s\n", script, lineno, msg);
+    if (recording)
+        remove(recording);
+    exit(1);
+}
+
+static void
+set_abs(struct SynapticsRecordHeader *header, int code,
+        int min, int max, int res, int fuzz)
+{
+    header->abs_bits[code / 8] |= 1 << (code % 8);
+    header->abs[code].minimum = min;
+    header->abs[code].maximum = max;
+    header->abs[code].resolution = res;
+    header->abs[code].fuzz = fuzz;
+}
+
+static void
+set_key(struct SynapticsRecordHeader *header, int code)
+{
+    header->key_bits[code / 8] |= 1 << (code % 8);
+}
+
+static void
+init_header(struct SynapticsRecordHeader *header)
+{
+    memset(header, 0, sizeof(*header));
+    header->magic = SYNAPTICS_RECORD_MAGIC;
+    header->version = SYNAPTICS_RECORD_VERSION;
+    header->header_size = sizeof(*header);
+    header->event_size = sizeof(struct SynapticsRecordEvent);
+    header->bustype = BUS_I8042;
+    strcpy(header->name, "mkrec touchpad");
+
+    /* what EvdevIsTouchpad() looks for */
+    set_key(header, BTN_LEFT);
+    set_key(header, BTN_TOUCH);
+    set_key(header, BTN_TOOL_FINGER);
+}
+
+/**
+ * Handle a device line.
+ *
+ * @return 0 if the line isn't one.
+ */
+static int
+parse_device(struct SynapticsRecordHeader *header, const char *line)
+{
+    int min, max, res, fuzz = 0;
+    unsigned int slots;
+    char name[80];
+
+    if (sscanf(line, "x %d %d %d %d", &min, &max, &res, &fuzz) >= 3) {
+        set_abs(header, ABS_X, min, max, res, fuzz);
+        set_abs(header, ABS_MT_POSITION_X, min, max, res, fuzz);
+    } else if (sscanf(line, "y %d %d %d %d", &min, &max, &res, &fuzz) >= 3) {
+        set_abs(header, ABS_Y, min, max, res, fuzz);
+        set_abs(header, ABS_MT_POSITION_Y, min, max, res, fuzz);
+    } else if (sscanf(line, "pressure %d %d", &min, &max) == 2) {
+        set_abs(header, ABS_PRESSURE, min, max, 0, 0);
+        set_abs(header, ABS_MT_PRESSURE, min, max, 0, 0);
+    } else if (sscanf(line, "slots %u", &slots) == 1) {
+        if (slots < 1 || slots > 32)
+            die("bad slot count");
+        header->num_slots = slots;
+        set_abs(header, ABS_MT_SLOT, 0, slots - 1, 0, 0);
+        set_abs(header, ABS_MT_TRACKING_ID, 0, 65535, 0, 0);
+    } else if (!strncmp(line, "clickpad", 8)) {
+        header->props |= 1 << INPUT_PROP_BUTTONPAD;
+    } else if (sscanf(line, "name %79[^\n]", name) == 1) {
+        strcpy(header->name, name);
+    } else if (!strncmp(line, "option ", 7)) {
+        /* not part of the recording */
+    } else
+        return 0;
+
+    return 1;
+}
+
+static void
+write_event(FILE *out, int type, int code, int value)
+{
+    struct SynapticsRecordEvent ev;
+
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+
+    if (fwrite(&ev, sizeof(ev), 1, out) != 1)
+        die("write failed");
+}
+
+static void
+parse_frame(FILE *out, char *line, unsigned int *last)
+{
+    unsigned int millis;
+    int syn = SYN_REPORT;
+    char *tok;
+
+    tok = strtok(line, " \t\n");
+    millis = strtoul(tok, NULL, 10);
+    if (millis < *last)
+        die("time goes backwards");
+    *last = millis;
+
+    write_event(out, SYNAPTICS_RECORD_TIME, 0, millis);
+
+    while ((tok = strtok(NULL, " \t\n"))) {
+        char *value, *end;
+        int i;
+
+        if (!strcmp(tok, "dropped")) {
+            syn = SYN_DROPPED;
+            continue;
+        }
+
+        for (i = 0; i < sizeof(frame_codes) / sizeof(frame_codes[0]); i++)
+            if (!strcmp(tok, frame_codes[i].name))
+                break;
+        if (i == sizeof(frame_codes) / sizeof(frame_codes[0]))
+            die("unknown event");
+
+        value = strtok(NULL, " \t\n");
+        if (!value)
+            die("event without a value");
+        write_event(out, frame_codes[i].type, frame_codes[i].code,
+                    strtol(value, &end, 10));
+        if (*end)
+            die("bad value");
+    }
+
+    write_event(out, EV_SYN, syn, 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct SynapticsRecordHeader header;
+    unsigned int last = 0;
+    int have_header = 0;
+    char line[1024];
+    FILE *in, *out;
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: mkrec script recording\n");
+        return 1;
+    }
+    script = argv[1];
+
+    in = fopen(argv[1], "r");
+    if (!in) {
+        fprintf(stderr, "Can't open %s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+    out = fopen(argv[2], "wb");
+    if (!out) {
+        fprintf(stderr, "Can't create %s: %s\n", argv[2], strerror(errno));
+        return 1;
+    }
+    recording = argv[2];
+
+    init_header(&header);
+
+    while (fgets(line, sizeof(line), in)) {
+        char *p = line + strspn(line, " \t");
+
+        lineno++;
+        if (*p == '#' || *p == '\n' || !*p)
+            continue;
+
+        if (*p < '0' || *p > '9') {
+            if (have_header)
+                die("device line after the first frame");
+            if (!parse_device(&header, p))
+                die("unknown device line");
+            continue;
+        }
+
+        if (!have_header) {
+            if (fwrite(&header, sizeof(header), 1, out) != 1)
+                die("write failed");
+            have_header = 1;
+        }
+        parse_frame(out, p, &last);
+    }
+
+    fclose(in);
+    if (!have_header)
+        die("no frames");
+    if (fclose(out)) {
+        fprintf(stderr, "Can't write %s: %s\n", argv[2], strerror(errno));
+        remove(recording);
+        return 1;
+    }
+
+    return 0;
+}
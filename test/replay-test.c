@@ -0,0 +1,405 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * replay-test: play a recording of the test corpus through the driver's
+ * frame path and compare what the engine posts with the golden output.
+ *
+ * For corpus/foo.rec the script is corpus/foo.evt and the golden output
+ * corpus/foo.out in the source directory. The script's option lines set
+ * driver options, everything else is at the driver's defaults. On a
+ * mismatch the actual output is left in corpus/foo.actual, -u writes it to
+ * the golden file instead.
+ *
+ * Any number of recordings can be given, they are played in parallel, one
+ * FramePlayer each. What every recording reports is collected and printed
+ * in the order of the arguments.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "player.h"
+#include "workers.h"
+
+#define GOLDEN_HEADER "# replay-test 1"
+
+/* PlayerFinish() limit, long enough for any tap or scroll to finish */
+#define FINISH_MS 2000
+
+struct Output {
+    FILE *f;
+    CARD32 start;               /* time of the first event */
+    struct FramePlayer *player;
+};
+
+static CARD32
+output_time(struct Output *out)
+{
+    return out->player->sim.now - out->start;
+}
+
+static void
+output_motion(void *data, int dx, int dy)
+{
+    struct Output *out = data;
+
+    fprintf(out->f, "%6u motion %d %d\n", output_time(out), dx, dy);
+}
+
+static void
+output_button(void *data, int button, Bool is_down)
+{
+    struct Output *out = data;
+
+    fprintf(out->f, "%6u button %d %s\n", output_time(out), button,
+            is_down ? "down" : "up");
+}
+
+static void
+output_scroll(void *data, int dx, int dy)
+{
+    struct Output *out = data;
+
+    fprintf(out->f, "%6u scroll %d %d\n", output_time(out), dx, dy);
+}
+
+static const struct GestureSink output_sink = {
+    output_motion,
+    output_button,
+    output_scroll,
+    NULL
+};
+
+static void
+usage(void)
+{
+    fprintf(stderr, "Usage: replay-test [-u] [-j jobs] [-s srcdir] corpus/name.rec...\n");
+    fprintf(stderr, "  -u Write the golden output instead of comparing with it.\n");
+    fprintf(stderr, "  -j Recordings played at the same time (default: one per\n");
+    fprintf(stderr, "     processor).\n");
+    fprintf(stderr, "  -s Where the scripts and golden output are (default .).\n");
+    exit(99);
+}
+
+/**
+ * Play rec with the options from script, the output goes to f.
+ */
+static Bool
+play(const struct SynapticsRecord *rec, const char *script, FILE *f,
+     FILE *log)
+{
+    SynapticsParameters para;
+    struct RecordDevice dev;
+    struct FramePlayer player;
+    struct Output out;
+    struct RecordCursor cur;
+    const struct SynapticsRecordEvent *ev;
+
+    RecordGetDevice(rec, &dev);
+    PlayerParameters(&para, &dev);
+    if (!PlayerScriptOptions(&para, &dev, script, log))
+        return FALSE;
+
+    RecordRewind(rec, &cur);
+    out.f = f;
+    out.start = cur.millis;
+    out.player = &player;
+    PlayerInit(&player, &para, out.start, &output_sink, &out);
+
+    fprintf(f, "%s\n", GOLDEN_HEADER);
+    while ((ev = RecordNext(rec, &cur)))
+        PlayerFeed(&player, ev->type, ev->code, ev->value, cur.millis);
+    PlayerFinish(&player, FINISH_MS);
+    fprintf(f, "# %lu frames\n", player.frames);
+
+    return TRUE;
+}
+
+static char *
+read_file(const char *path, size_t *len)
+{
+    char *buf = NULL;
+    FILE *f;
+    long size;
+
+    f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= 0 &&
+        fseek(f, 0, SEEK_SET) == 0 && (buf = malloc(size + 1))) {
+        *len = fread(buf, 1, size, f);
+        buf[*len] = '\0';
+    }
+    fclose(f);
+
+    return buf;
+}
+
+static Bool
+write_file(const char *path, const char *buf, size_t len, FILE *log)
+{
+    FILE *f;
+
+    f = fopen(path, "wb");
+    if (!f || fwrite(buf, 1, len, f) != len) {
+        fprintf(log, "Can't write %s: %s\n", path, strerror(errno));
+        if (f)
+            fclose(f);
+        return FALSE;
+    }
+
+    return fclose(f) == 0;
+}
+
+/* print the first line where the output differs from the golden one */
+static void
+show_difference(const char *path, const char *expected, const char *output,
+                FILE *log)
+{
+    const char *a = expected, *b = output;
+    int line = 1;
+
+    while (*a && *a == *b) {
+        if (*a == '\n')
+            line++;
+        a++;
+        b++;
+    }
+    while (a > expected && a[-1] != '\n') {
+        a--;
+        b--;
+    }
+
+    fprintf(log, "%s:%d: expected \"%.*s\", got \"%.*s\"\n", path, line,
+            (int) strcspn(a, "\n"), a, (int) strcspn(b, "\n"), b);
+}
+
+static char *
+make_path(const char *dir, const char *base, const char *ext)
+{
+    size_t len = strlen(dir) + strlen(base) + strlen(ext) + 2;
+    char *path = malloc(len);
+
+    if (!path) {
+        fprintf(stderr, "Out of memory\n");
+        exit(99);
+    }
+    snprintf(path, len, "%s/%s%s", dir, base, ext);
+
+    return path;
+}
+
+struct Job {
+    const char *recording;
+    int status;                 /* exit status: 0 pass, 1 fail, 99 error */
+    char *log;                  /* what the recording reports */
+    size_t log_len;
+};
+
+struct Run {
+    const char *srcdir;
+    Bool update;
+    struct Job *jobs;
+};
+
+/**
+ * Play one recording and compare or update its golden output.
+ *
+ * @return The exit status for it.
+ */
+static int
+run_recording(const char *recording, const char *srcdir, Bool update,
+              FILE *log)
+{
+    struct SynapticsRecord rec;
+    char *base, *script, *golden, *actual;
+    char *output = NULL, *expected;
+    size_t len, output_len, expected_len;
+    FILE *f;
+    int fd, rc, status = 1;
+
+    len = strlen(recording);
+    if (len < 4 || strcmp(recording + len - 4, ".rec")) {
+        fprintf(log, "%s: not a .rec file\n", recording);
+        return 99;
+    }
+    base = strdup(recording);
+    if (!base) {
+        fprintf(log, "Out of memory\n");
+        return 99;
+    }
+    base[len - 4] = '\0';
+
+    script = make_path(srcdir, base, ".evt");
+    golden = make_path(srcdir, base, ".out");
+    actual = make_path(".", base, ".actual");
+    free(base);
+
+    fd = open(recording, O_RDONLY);
+    if (fd == -1) {
+        fprintf(log, "Can't open %s: %s\n", recording, strerror(errno));
+        status = 99;
+        goto out;
+    }
+    rc = RecordMap(&rec, fd);
+    close(fd);
+    if (rc) {
+        fprintf(log, "%s is not a touchpad recording: %s\n", recording,
+                strerror(rc));
+        status = 99;
+        goto out;
+    }
+
+    f = open_memstream(&output, &output_len);
+    if (!f) {
+        RecordUnmap(&rec);
+        status = 99;
+        goto out;
+    }
+    rc = play(&rec, script, f, log);
+    fclose(f);
+    RecordUnmap(&rec);
+    if (!rc) {
+        status = 99;
+        goto out;
+    }
+
+    if (update) {
+        status = write_file(golden, output, output_len, log) ? 0 : 99;
+        goto out;
+    }
+
+    expected = read_file(golden, &expected_len);
+    if (!expected) {
+        fprintf(log, "Can't read %s: %s\n", golden, strerror(errno));
+        status = 99;
+        goto out;
+    }
+
+    if (expected_len == output_len && !memcmp(expected, output, output_len)) {
+        remove(actual);
+        status = 0;
+    } else {
+        show_difference(golden, expected, output, log);
+        if (write_file(actual, output, output_len, log))
+            fprintf(log, "Output left in %s, compare with diff -u %s %s\n",
+                    actual, golden, actual);
+    }
+    free(expected);
+
+ out:
+    free(output);
+    free(script);
+    free(golden);
+    free(actual);
+
+    return status;
+}
+
+static void
+run_job(void *data, size_t index)
+{
+    struct Run *run = data;
+    struct Job *job = &run->jobs[index];
+    FILE *log;
+
+    log = open_memstream(&job->log, &job->log_len);
+    if (!log) {
+        job->status = 99;
+        return;
+    }
+    job->status = run_recording(job->recording, run->srcdir, run->update, log);
+    fclose(log);
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct Run run = { ".", FALSE, NULL };
+    int workers = WorkersDefault();
+    int count, failed = 0, status = 0;
+    int c, i;
+
+    while ((c = getopt(argc, argv, "uj:s:?")) != EOF) {
+        switch (c) {
+        case 'u':
+            run.update = TRUE;
+            break;
+        case 'j':
+            workers = atoi(optarg);
+            if (workers < 1)
+                usage();
+            break;
+        case 's':
+            run.srcdir = optarg;
+            break;
+        default:
+            usage();
+            break;
+        }
+    }
+    if (optind == argc)
+        usage();
+
+    count = argc - optind;
+    run.jobs = calloc(count, sizeof(*run.jobs));
+    if (!run.jobs) {
+        fprintf(stderr, "Out of memory\n");
+        return 99;
+    }
+    for (i = 0; i < count; i++)
+        run.jobs[i].recording = argv[optind + i];
+
+    WorkersRun(count, workers, run_job, &run);
+
+    for (i = 0; i < count; i++) {
+        struct Job *job = &run.jobs[i];
+
+        if (job->log_len)
+            fwrite(job->log, 1, job->log_len, stderr);
+        free(job->log);
+
+        if (job->status) {
+            failed++;
+            if (count > 1)
+                printf("FAIL: %s\n", job->recording);
+        }
+        /* a hard error wins over a mismatch */
+        if (job->status > status)
+            status = job->status;
+    }
+    if (count > 1)
+        printf("# %d of %d recordings failed\n", failed, count);
+
+    free(run.jobs);
+    return status;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * synclient-test: run synclient's var=value handling against a fake
+ * server. The Xlib calls synclient makes for it are defined here and
+ * take precedence over libX11/libXi, the device has two profiles with
+ * their own copy of the "Synaptics Finger" property.
+ */
+
+#define main synclient_main
+#include "../tools/synclient.c"
+#undef main
+
+#define FINGER_ITEMS 3
+
+static const char *atom_names[64];
+static int num_atoms = 1;       /* 0 is None */
+
+static long finger[2][FINGER_ITEMS] = {
+    {25, 30, 257},
+    {35, 50, 100},
+};
+
+static long active_profile;
+static XErrorHandler error_handler;
+
+Atom
+XInternAtom(Display * dpy, _Xconst char *name, Bool only_if_exists)
+{
+    int i;
+
+    for (i = 1; i < num_atoms; i++)
+        if (strcmp(atom_names[i], name) == 0)
+            return i;
+    atom_names[num_atoms] = name;
+    return num_atoms++;
+}
+
+Status
+XInternAtoms(Display * dpy, char **names, int count, Bool only_if_exists,
+             Atom * atoms)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+        atoms[i] = XInternAtom(dpy, names[i], only_if_exists);
+    return 1;
+}
+
+XErrorHandler
+XSetErrorHandler(XErrorHandler handler)
+{
+    XErrorHandler old = error_handler;
+
+    error_handler = handler;
+    return old;
+}
+
+int
+XSync(Display * dpy, Bool discard)
+{
+    return 0;
+}
+
+int
+XFlush(Display * dpy)
+{
+    return 0;
+}
+
+int
+XFree(void *data)
+{
+    free(data);
+    return 0;
+}
+
+static long *
+new_items(const long *values, int count)
+{
+    long *data = malloc(count * sizeof(long));
+
+    memcpy(data, values, count * sizeof(long));
+    return data;
+}
+
+int
+XGetDeviceProperty(Display * dpy, XDevice * dev, Atom property, long offset,
+                   long length, Bool delete, Atom req_type,
+                   Atom * actual_type, int *actual_format,
+                   unsigned long *nitems, unsigned long *bytes_after,
+                   unsigned char **prop)
+{
+    const char *name = atom_names[property];
+
+    *bytes_after = 0;
+    *actual_type = XA_INTEGER;
+    *actual_format = 32;
+
+    if (strcmp(name, SYNAPTICS_PROP_ACTIVE_PROFILE) == 0) {
+        *nitems = 1;
+        *prop = (unsigned char *) new_items(&active_profile, 1);
+    }
+    else if (strcmp(name, SYNAPTICS_PROP_FINGER) == 0) {
+        *nitems = FINGER_ITEMS;
+        *prop = (unsigned char *) new_items(finger[active_profile],
+                                            FINGER_ITEMS);
+    }
+    else
+        return BadAtom;
+
+    return Success;
+}
+
+void
+XChangeDeviceProperty(Display * dpy, XDevice * dev, Atom property,
+                      Atom type, int format, int mode,
+                      _Xconst unsigned char *data, int nelements)
+{
+    const char *name = atom_names[property];
+    const long *values = (const long *) data;
+
+    if (strcmp(name, SYNAPTICS_PROP_ACTIVE_PROFILE) == 0 &&
+        nelements == 1 && values[0] >= 0 && values[0] < 2)
+        active_profile = values[0];
+    else if (strcmp(name, SYNAPTICS_PROP_FINGER) == 0 &&
+             nelements == FINGER_ITEMS)
+        memcpy(finger[active_profile], values, sizeof(finger[0]));
+    else {
+        XErrorEvent err = { 0 };
+
+        err.error_code = BadValue;
+        error_handler(dpy, &err);
+    }
+}
+
+static int failed;
+
+static void
+check(const char *what, long actual, long expected)
+{
+    if (actual != expected) {
+        printf("FAIL: %s is %ld, expected %ld\n", what, actual, expected);
+        failed = 1;
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    /* the second profile's FingerPress must not be overwritten with the
+     * first one's, it is in the same property as the values set */
+    char arg0[] = "synclient", arg1[] = "ActiveProfile=1";
+    char arg2[] = "FingerLow=20", arg3[] = "FingerHigh=40";
+    char *args[] = { arg0, arg1, arg2, arg3 };
+
+    prop_cache_init(NULL);
+
+    check("dp_set_variables()", dp_set_variables(NULL, NULL, 4, args, 1), 0);
+    check("active profile", active_profile, 1);
+    check("profile 1 FingerLow", finger[1][0], 20);
+    check("profile 1 FingerHigh", finger[1][1], 40);
+    check("profile 1 FingerPress", finger[1][2], 100);
+    check("profile 0 FingerLow", finger[0][0], 25);
+    check("profile 0 FingerHigh", finger[0][1], 30);
+    check("profile 0 FingerPress", finger[0][2], 257);
+
+    prop_cache_free();
+
+    return failed;
+}
@@ -0,0 +1,751 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * synbench: push touchpad recordings through the driver's frame path as
+ * fast as possible and report what a frame costs.
+ *
+ * Every recording is played by a FramePlayer, i.e. decoded with
+ * EvFrameFeed() and handled by the gesture engine like the driver does it,
+ * with the posting calls only counted. Time comes from a simulated clock:
+ * it jumps to the recorded time of every event and the engine timer fires
+ * at exactly the offset it was armed for. At the end of a replay the clock
+ * runs on until the timers armed by the last frames (tap clicks, coasting)
+ * have fired, they cost and post like the others.
+ *
+ * Every recording is measured several times, in passes over all of them,
+ * so a stretch of time the machine is busy with something else doesn't
+ * fall on one recording only. A pass replays the recording until enough
+ * frames were timed and takes the median of the replays. Other work only
+ * ever makes frames slower, so the fastest pass is reported and how far
+ * the fastest quarter of the passes spreads as noise. A comparison with -b
+ * doesn't count a slowdown within the noise of the two runs as a
+ * regression.
+ *
+ * The driver options are at their defaults, with -s the option lines of a
+ * corpus script are applied like replay-test does it, so a recording of
+ * the test corpus takes the same path as in make check.
+ *
+ * The output is one line per recording and can be fed back with -b to
+ * compare two builds on the same corpus.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+
+#include "player.h"
+#include "workers.h"
+
+#define RESULT_HEADER "# synbench 2"
+
+/* PlayerFinish() limit, long enough for any tap or scroll to finish */
+#define FINISH_MS 2000
+
+#define MAX_PASSES 64
+
+/* allocations made while frames are processed, counted through the
+   linker's --wrap for malloc, calloc and realloc; per thread, recordings
+   measured at the same time don't count each other's */
+static __thread unsigned long allocations;
+
+extern void *__real_malloc(size_t size);
+extern void *__real_calloc(size_t nmemb, size_t size);
+extern void *__real_realloc(void *ptr, size_t size);
+
+void *
+__wrap_malloc(size_t size)
+{
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+    allocations++;
+    return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+
+/* one measurement of a recording */
+struct Pass {
+    unsigned long frames;       /* per replay */
+    double ns_per_frame;        /* median of the replays */
+    unsigned long p50, p99, p999;       /* ns */
+    unsigned long samples;      /* frames timed one by one */
+    unsigned long replayed;     /* frames replayed as a whole */
+    unsigned long allocs;       /* in those replays */
+    unsigned long posts;
+};
+
+struct Result {
+    char *name;
+    char error[256];            /* why the recording couldn't be measured */
+    unsigned long frames;
+    double ns_per_frame;        /* of the fastest pass */
+    double noise;               /* the first quartile is this much slower, % */
+    unsigned long p50, p99, p999;       /* ns, of the fastest pass */
+    double allocs_per_frame;
+    double out_per_frame;
+};
+
+struct Bench {
+    unsigned long posts;        /* motion, button and scroll posts */
+};
+
+static void
+bench_post_motion(void *data, int dx, int dy)
+{
+    struct Bench *bench = data;
+
+    bench->posts++;
+}
+
+static void
+bench_post_button(void *data, int button, Bool is_down)
+{
+    struct Bench *bench = data;
+
+    bench->posts++;
+}
+
+static void
+bench_post_scroll(void *data, int dx, int dy)
+{
+    struct Bench *bench = data;
+
+    bench->posts++;
+}
+
+static const struct GestureSink bench_sink = {
+    bench_post_motion,
+    bench_post_button,
+    bench_post_scroll,
+    NULL
+};
+
+static void
+usage(void)
+{
+    fprintf(stderr, "Usage: synbench [-n passes] [-f frames] [-s srcdir] [-j jobs] [-b baseline] [-t percent] recording...\n");
+    fprintf(stderr, "  -n Measure every recording this many times, up to %d\n", MAX_PASSES);
+    fprintf(stderr, "     (default 20).\n");
+    fprintf(stderr, "  -f Frames to time per measurement, the recording is replayed\n");
+    fprintf(stderr, "     until there are this many (default 25000).\n");
+    fprintf(stderr, "  -s Set the options of the corpus script srcdir/foo.evt for\n");
+    fprintf(stderr, "     recording foo.rec, like replay-test.\n");
+    fprintf(stderr, "  -j Recordings measured at the same time (default 1). More\n");
+    fprintf(stderr, "     finish sooner but disturb each other's timings, output\n");
+    fprintf(stderr, "     and allocation counts aren't affected.\n");
+    fprintf(stderr, "  -b Compare against the output of an earlier run.\n");
+    fprintf(stderr, "  -t Per-frame slowdown that counts as a regression in percent,\n");
+    fprintf(stderr, "     if it is above the noise of both runs too (default 5).\n");
+    fprintf(stderr, "  -? Show this help message.\n");
+    exit(1);
+}
+
+static unsigned long long
+get_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int
+compare_samples(const void *a, const void *b)
+{
+    unsigned long sa = *(const unsigned long *) a;
+    unsigned long sb = *(const unsigned long *) b;
+
+    return (sa > sb) - (sa < sb);
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+    double da = *(const double *) a;
+    double db = *(const double *) b;
+
+    return (da > db) - (da < db);
+}
+
+static unsigned long
+percentile(const unsigned long *sorted, unsigned long n, double p)
+{
+    return n ? sorted[(unsigned long) ((n - 1) * p)] : 0;
+}
+
+/**
+ * Replay rec once without timing single frames, reading the clock costs
+ * about as much as a frame. The timers left armed at the end are run too.
+ *
+ * @return The time the replay took in ns, frames is set to the number of
+ * frames in it.
+ */
+static unsigned long long
+bench_replay(const struct SynapticsRecord *rec,
+             const SynapticsParameters *para, struct Bench *bench,
+             unsigned long *frames)
+{
+    struct FramePlayer player;
+    struct RecordCursor cur;
+    const struct SynapticsRecordEvent *ev;
+    unsigned long long start;
+
+    memset(bench, 0, sizeof(*bench));
+    RecordRewind(rec, &cur);
+    PlayerInit(&player, para, cur.millis, &bench_sink, bench);
+
+    start = get_ns();
+    while ((ev = RecordNext(rec, &cur)))
+        PlayerFeed(&player, ev->type, ev->code, ev->value, cur.millis);
+    PlayerFinish(&player, FINISH_MS);
+    *frames = player.frames;
+
+    return get_ns() - start;
+}
+
+/**
+ * Replay rec once, appending the cost of every frame to samples. Timers
+ * aren't part of a frame's cost.
+ */
+static void
+bench_frames(const struct SynapticsRecord *rec,
+             const SynapticsParameters *para, struct Bench *bench,
+             unsigned long *samples, unsigned long *nsamples)
+{
+    struct FramePlayer player;
+    struct RecordCursor cur;
+    const struct SynapticsRecordEvent *ev;
+    unsigned long long start = 0;
+
+    memset(bench, 0, sizeof(*bench));
+    RecordRewind(rec, &cur);
+    PlayerInit(&player, para, cur.millis, &bench_sink, bench);
+
+    while ((ev = RecordNext(rec, &cur))) {
+        if (!start) {
+            /* timers due before this frame fire first */
+            if (player.sim.armed)
+                SimClockAdvance(&player.sim, cur.millis);
+            start = get_ns();
+        }
+
+        if (PlayerFeed(&player, ev->type, ev->code, ev->value,
+                       cur.millis)) {
+            samples[(*nsamples)++] = get_ns() - start;
+            start = 0;
+        }
+    }
+    PlayerFinish(&player, FINISH_MS);
+}
+
+/**
+ * Measure one recording once.
+ *
+ * @return Nonzero on success, otherwise error says what went wrong.
+ */
+static int
+bench_file(const char *path, const char *script, unsigned long min_frames,
+           struct Pass *pass, char *error, size_t error_size)
+{
+    struct SynapticsRecord rec;
+    SynapticsParameters para;
+    struct RecordDevice dev;
+    struct Bench bench;
+    unsigned long *samples = NULL;
+    double *runs = NULL;
+    unsigned long nsamples = 0, size = 0;
+    int fd, rc, nruns = 0, runs_size = 0;
+    Bool oom = FALSE;
+
+    memset(pass, 0, sizeof(*pass));
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        snprintf(error, error_size, "Can't open %s: %s", path,
+                 strerror(errno));
+        return 0;
+    }
+    rc = RecordMap(&rec, fd);
+    close(fd);
+    if (rc) {
+        snprintf(error, error_size, "%s is not a touchpad recording: %s",
+                 path, strerror(rc));
+        return 0;
+    }
+
+    RecordGetDevice(&rec, &dev);
+    PlayerParameters(&para, &dev);
+    if (script) {
+        FILE *log = fmemopen(error, error_size, "w");
+        Bool ok;
+
+        if (!log) {
+            snprintf(error, error_size, "Out of memory");
+            RecordUnmap(&rec);
+            return 0;
+        }
+        ok = PlayerScriptOptions(&para, &dev, script, log);
+        fclose(log);
+        if (!ok) {
+            error[strcspn(error, "\n")] = '\0';
+            RecordUnmap(&rec);
+            return 0;
+        }
+    }
+
+    while (nsamples < min_frames || !nruns) {
+        unsigned long long total;
+        unsigned long before, frames;
+
+        /* room for one more replay, every frame ends with a SYN_REPORT,
+           so there are fewer frames than records */
+        if (size - nsamples < rec.num_records + 1) {
+            unsigned long *tmp;
+
+            size = size ? size * 2 : rec.num_records + 1;
+            if (size - nsamples < rec.num_records + 1)
+                size = nsamples + rec.num_records + 1;
+            tmp = realloc(samples, size * sizeof(*samples));
+            if (!tmp) {
+                oom = TRUE;
+                break;
+            }
+            samples = tmp;
+        }
+        if (nruns == runs_size) {
+            double *tmp;
+
+            runs_size = runs_size ? runs_size * 2 : 64;
+            tmp = realloc(runs, runs_size * sizeof(*runs));
+            if (!tmp) {
+                oom = TRUE;
+                break;
+            }
+            runs = tmp;
+        }
+
+        /* the replays alternate between measuring the cost per frame
+           and the distribution of single frames */
+        before = allocations;
+        total = bench_replay(&rec, &para, &bench, &frames);
+        pass->allocs += allocations - before;
+        pass->posts += bench.posts;
+
+        /* a recording without frames would never get there */
+        if (!frames)
+            break;
+        runs[nruns++] = (double) total / frames;
+        pass->replayed += frames;
+
+        bench_frames(&rec, &para, &bench, samples, &nsamples);
+    }
+    RecordUnmap(&rec);
+
+    if (oom) {
+        snprintf(error, error_size, "Out of memory");
+        free(samples);
+        free(runs);
+        return 0;
+    }
+
+    qsort(samples, nsamples, sizeof(*samples), compare_samples);
+    qsort(runs, nruns, sizeof(*runs), compare_doubles);
+
+    pass->samples = nsamples;
+    if (nruns) {
+        pass->frames = pass->replayed / nruns;
+        pass->ns_per_frame = runs[(nruns - 1) / 2];
+    }
+    pass->p50 = percentile(samples, nsamples, 0.50);
+    pass->p99 = percentile(samples, nsamples, 0.99);
+    pass->p999 = percentile(samples, nsamples, 0.999);
+
+    free(samples);
+    free(runs);
+
+    return 1;
+}
+
+struct Job {
+    const char *path;
+    char *script;               /* options to set, NULL for none */
+    int ok;
+    char error[256];
+    struct Pass pass;
+};
+
+/* jobs[pass * count + recording], run in that order */
+struct Run {
+    int count;
+    unsigned long min_frames;
+    struct Job *jobs;
+};
+
+static void
+bench_job(void *data, size_t index)
+{
+    struct Run *run = data;
+    struct Job *job = &run->jobs[index];
+
+    job->ok = bench_file(job->path, job->script, run->min_frames,
+                         &job->pass, job->error, sizeof(job->error));
+}
+
+/**
+ * The script of a corpus recording, srcdir/corpus/foo.evt for
+ * corpus/foo.rec.
+ *
+ * @return The path, NULL if recording isn't a .rec file.
+ */
+static char *
+script_path(const char *srcdir, const char *recording)
+{
+    size_t len = strlen(recording);
+    char *path;
+
+    if (len < 4 || strcmp(recording + len - 4, ".rec"))
+        return NULL;
+
+    len += strlen(srcdir) + 2;
+    path = malloc(len);
+    if (!path) {
+        fprintf(stderr, "Out of memory\n");
+        exit(2);
+    }
+    snprintf(path, len, "%s/%.*s.evt", srcdir,
+             (int) strlen(recording) - 4, recording);
+
+    return path;
+}
+
+static int
+compare_passes(const void *a, const void *b)
+{
+    const struct Pass *pa = *(const struct Pass * const *) a;
+    const struct Pass *pb = *(const struct Pass * const *) b;
+
+    return compare_doubles(&pa->ns_per_frame, &pb->ns_per_frame);
+}
+
+/**
+ * Combine the passes over one recording into its result.
+ *
+ * @return Nonzero on success, otherwise res->error says what went wrong.
+ */
+static int
+make_result(const struct Run *run, int recording, int passes,
+            struct Result *res)
+{
+    const struct Pass *sorted[MAX_PASSES];
+    unsigned long replayed = 0, allocs = 0, posts = 0;
+    const struct Pass *fastest, *quartile;
+    int i;
+
+    memset(res, 0, sizeof(*res));
+
+    for (i = 0; i < passes; i++) {
+        const struct Job *job = &run->jobs[i * run->count + recording];
+
+        if (!job->ok) {
+            snprintf(res->error, sizeof(res->error), "%s", job->error);
+            return 0;
+        }
+        sorted[i] = &job->pass;
+        replayed += job->pass.replayed;
+        allocs += job->pass.allocs;
+        posts += job->pass.posts;
+    }
+    qsort(sorted, passes, sizeof(*sorted), compare_passes);
+    fastest = sorted[0];
+    quartile = sorted[(passes - 1) / 4];
+
+    res->name = strdup(run->jobs[recording].path);
+    if (!res->name) {
+        snprintf(res->error, sizeof(res->error), "Out of memory");
+        return 0;
+    }
+
+    res->frames = fastest->frames;
+    res->ns_per_frame = fastest->ns_per_frame;
+    if (fastest->ns_per_frame > 0)
+        res->noise = (quartile->ns_per_frame - fastest->ns_per_frame) *
+            100.0 / fastest->ns_per_frame;
+    res->p50 = fastest->p50;
+    res->p99 = fastest->p99;
+    res->p999 = fastest->p999;
+    if (replayed) {
+        res->allocs_per_frame = (double) allocs / replayed;
+        res->out_per_frame = (double) posts / replayed;
+    }
+
+    return 1;
+}
+
+static void
+print_result(const struct Result *res)
+{
+    printf("%s %lu %.1f %.1f %lu %lu %lu %.3f %.3f\n", res->name,
+           res->frames, res->ns_per_frame, res->noise, res->p50, res->p99,
+           res->p999, res->allocs_per_frame, res->out_per_frame);
+}
+
+/**
+ * Read the output of an earlier run, which must come from this version of
+ * synbench.
+ *
+ * @return The number of results read, -1 on error.
+ */
+static int
+read_baseline(const char *path, struct Result **results)
+{
+    FILE *f;
+    char line[4096];
+    int n = 0, size = 0;
+
+    *results = NULL;
+
+    f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    if (!fgets(line, sizeof(line), f) ||
+        strncmp(line, RESULT_HEADER, strlen(RESULT_HEADER)) ||
+        line[strlen(RESULT_HEADER)] != '\n') {
+        fprintf(stderr, "%s is not the output of this synbench\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        struct Result res;
+        char name[4096];
+
+        if (line[0] == '#')
+            continue;
+        if (sscanf(line, "%4095s %lu %lf %lf %lu %lu %lu %lf %lf", name,
+                   &res.frames, &res.ns_per_frame, &res.noise, &res.p50,
+                   &res.p99, &res.p999, &res.allocs_per_frame,
+                   &res.out_per_frame) != 9)
+            continue;
+
+        if (n == size) {
+            struct Result *tmp;
+
+            size = size ? size * 2 : 64;
+            tmp = realloc(*results, size * sizeof(**results));
+            if (!tmp)
+                break;
+            *results = tmp;
+        }
+        res.name = strdup(name);
+        (*results)[n++] = res;
+    }
+
+    fclose(f);
+    return n;
+}
+
+static double
+change(double now, double then)
+{
+    return then > 0 ? (now - then) * 100.0 / then : 0;
+}
+
+/**
+ * Compare a result against the baseline.
+ *
+ * @return TRUE if the recording got slower by more than threshold percent
+ * and more than the noise of both runs per frame, or now produces
+ * different output.
+ */
+static Bool
+compare_result(const struct Result *res, const struct Result *base, int nbase,
+               double threshold)
+{
+    Bool regressed;
+    double noise;
+    int i;
+
+    for (i = 0; i < nbase; i++)
+        if (base[i].name && !strcmp(base[i].name, res->name))
+            break;
+    if (i == nbase) {
+        printf("#   %s: not in the baseline\n", res->name);
+        return FALSE;
+    }
+    base = &base[i];
+
+    noise = res->noise + base->noise;
+    if (threshold < noise)
+        threshold = noise;
+    regressed = change(res->ns_per_frame, base->ns_per_frame) > threshold &&
+        change(res->p50, base->p50) > threshold;
+
+    printf("#   %s: ns/frame %+.1f%% (noise %.1f%%), p50 %+.1f%%, p99 %+.1f%%, p999 %+.1f%%%s\n",
+           res->name, change(res->ns_per_frame, base->ns_per_frame),
+           noise, change(res->p50, base->p50),
+           change(res->p99, base->p99), change(res->p999, base->p999),
+           regressed ? "  REGRESSION" : "");
+
+    /* the baseline went through printf("%.3f") */
+    if (res->frames != base->frames ||
+        fabs(res->out_per_frame - base->out_per_frame) > 0.0005) {
+        printf("#   %s: output changed, %lu frames %.3f out/frame, was %lu %.3f\n",
+               res->name, res->frames, res->out_per_frame,
+               base->frames, base->out_per_frame);
+        regressed = TRUE;
+    }
+    if (res->allocs_per_frame > base->allocs_per_frame + 0.0005) {
+        printf("#   %s: %.3f allocations per frame, was %.3f\n", res->name,
+               res->allocs_per_frame, base->allocs_per_frame);
+        regressed = TRUE;
+    }
+
+    return regressed;
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct Result *base = NULL;
+    const char *baseline = NULL, *srcdir = NULL;
+    double threshold = 5.0;
+    struct Run run = { 0, 25000, NULL };
+    int passes = 20, workers = 1;
+    int nbase = 0, regressions = 0, failed = 0;
+    int count, c, i;
+
+    while ((c = getopt(argc, argv, "n:f:s:j:b:t:?")) != EOF) {
+        switch (c) {
+        case 'n':
+            passes = atoi(optarg);
+            if (passes < 1 || passes > MAX_PASSES)
+                usage();
+            break;
+        case 'f':
+            run.min_frames = strtoul(optarg, NULL, 0);
+            break;
+        case 'j':
+            workers = atoi(optarg);
+            if (workers < 1)
+                usage();
+            break;
+        case 's':
+            srcdir = optarg;
+            break;
+        case 'b':
+            baseline = optarg;
+            break;
+        case 't':
+            threshold = atof(optarg);
+            break;
+        default:
+            usage();
+            break;
+        }
+    }
+    if (optind == argc)
+        usage();
+
+    if (baseline && (nbase = read_baseline(baseline, &base)) < 0)
+        exit(2);
+
+    count = argc - optind;
+    run.count = count;
+    run.jobs = calloc(count * passes, sizeof(*run.jobs));
+    if (!run.jobs) {
+        fprintf(stderr, "Out of memory\n");
+        exit(2);
+    }
+    for (i = 0; i < count * passes; i++) {
+        struct Job *job = &run.jobs[i];
+
+        job->path = argv[optind + i % count];
+        if (!srcdir)
+            continue;
+        if (i >= count) {
+            job->script = run.jobs[i % count].script;
+        } else if (!(job->script = script_path(srcdir, job->path))) {
+            fprintf(stderr, "%s: not a .rec file\n", job->path);
+            exit(2);
+        }
+    }
+
+    WorkersRun(count * passes, workers, bench_job, &run);
+
+    /* results in the order of the arguments, however they were run */
+    printf("%s\n", RESULT_HEADER);
+    printf("# recording frames ns/frame noise%% p50 p99 p999 allocs/frame out/frame\n");
+
+    for (i = 0; i < count; i++) {
+        struct Result res;
+
+        if (!make_result(&run, i, passes, &res)) {
+            fprintf(stderr, "%s\n", res.error);
+            failed++;
+            continue;
+        }
+
+        print_result(&res);
+        if (baseline && compare_result(&res, base, nbase, threshold))
+            regressions++;
+        free(res.name);
+    }
+    for (i = 0; i < count; i++)
+        free(run.jobs[i].script);
+    free(run.jobs);
+
+    if (baseline)
+        printf("# %d of %d recordings regressed\n", regressions,
+               count - failed);
+
+    for (i = 0; i < nbase; i++)
+        free(base[i].name);
+    free(base);
+
+    if (failed)
+        return 2;
+    return regressions ? 1 : 0;
+}
@@ -41,6 +41,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <ctype.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/time.h>
@@ -49,12 +52,17 @@
 #include <stddef.h>
 #include <math.h>
 #include <limits.h>
+#include <poll.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 
 #include <X11/Xdefs.h>
 #include <X11/Xatom.h>
 #include <X11/extensions/XI.h>
 #include <X11/extensions/XInput.h>
 #include "synaptics-properties.h"
+#include "synaptics-shm.h"
 
 #ifndef XATOM_FLOAT
 #define XATOM_FLOAT "FLOAT"
@@ -116,6 +124,8 @@ static struct Parameter params[] = {
 	{"MinTapPressure",			PT_INT,		1, 255,		SYNAPTICS_PROP_TAP_EXTRAS,	32,	0},
 	{"TapAnywhere",				PT_INT,		0,	1,		SYNAPTICS_PROP_TAP_EXTRAS,	32,	1},
 	{"TapHoldGesture",			PT_INT,		0,	30000,	SYNAPTICS_PROP_TAP_EXTRAS,	32,	2},
+	{"TypingTimeout",			PT_INT,		0,	10000,	SYNAPTICS_PROP_TYPING_TIMEOUT,	32,	0},
+	{"ActiveProfile",			PT_INT,		0,	7,		SYNAPTICS_PROP_ACTIVE_PROFILE,	32,	0},
 
     { NULL, 0, 0, 0, 0 }
 };
@@ -161,6 +171,189 @@ parse_cmd(char *cmd, struct Parameter **par)
     return 0;
 }
 
+/* Every distinct property referenced by params[], fetched at most once. */
+struct PropCache {
+    const char *name;           /* Property name */
+    Atom atom;                  /* None if the server doesn't know it */
+    Bool fetched;               /* XGetDeviceProperty done */
+    Bool dirty;                 /* data modified, needs to be written */
+    Atom type;                  /* None if the device doesn't have it */
+    int format;
+    unsigned long nitems;
+    unsigned char *data;
+};
+
+static struct PropCache prop_cache[sizeof(params) / sizeof(params[0])];
+static int prop_cache_size;
+static Atom float_type;
+
+static struct PropCache *
+prop_cache_find(const char *name)
+{
+    int i;
+
+    for (i = 0; i < prop_cache_size; i++)
+        if (strcmp(prop_cache[i].name, name) == 0)
+            return &prop_cache[i];
+    return NULL;
+}
+
+/* Intern the atoms for all properties and the float type in one request */
+static void
+prop_cache_init(Display * dpy)
+{
+    char *names[sizeof(params) / sizeof(params[0]) + 1];
+    Atom atoms[sizeof(params) / sizeof(params[0]) + 1];
+    int i;
+
+    for (i = 0; params[i].name; i++) {
+        if (prop_cache_find(params[i].prop_name))
+            continue;
+        prop_cache[prop_cache_size++].name = params[i].prop_name;
+    }
+
+    for (i = 0; i < prop_cache_size; i++)
+        names[i] = (char *) prop_cache[i].name;
+    names[prop_cache_size] = XATOM_FLOAT;
+
+    XInternAtoms(dpy, names, prop_cache_size + 1, True, atoms);
+
+    for (i = 0; i < prop_cache_size; i++)
+        prop_cache[i].atom = atoms[i];
+    float_type = atoms[prop_cache_size];
+
+    if (!float_type)
+        fprintf(stderr, "Float properties not available.\n");
+}
+
+/* Property data for par, fetching it from the server on first use. NULL if
+ * the property isn't available. */
+static struct PropCache *
+prop_cache_get(Display * dpy, XDevice * dev, struct Parameter *par)
+{
+    struct PropCache *pc = prop_cache_find(par->prop_name);
+    unsigned long bytes_after;
+
+    if (!pc || !pc->atom)
+        return NULL;
+
+    if (!pc->fetched) {
+        pc->fetched = True;
+        if (XGetDeviceProperty(dpy, dev, pc->atom, 0, 1000, False,
+                               AnyPropertyType, &pc->type, &pc->format,
+                               &pc->nitems, &bytes_after,
+                               &pc->data) != Success)
+            pc->type = None;
+    }
+
+    if (pc->type == None || par->prop_offset >= pc->nitems)
+        return NULL;
+
+    return pc;
+}
+
+static void
+prop_cache_free(void)
+{
+    int i;
+
+    for (i = 0; i < prop_cache_size; i++)
+        if (prop_cache[i].data)
+            XFree(prop_cache[i].data);
+    prop_cache_size = 0;
+}
+
+/* True if the cached property has the type and format par expects */
+static Bool
+prop_cache_format_ok(struct PropCache *pc, struct Parameter *par)
+{
+    switch (par->prop_format) {
+    case 8:
+        return pc->format == 8 && pc->type == XA_INTEGER;
+    case 32:
+        return pc->format == 32 &&
+            (pc->type == XA_INTEGER || pc->type == XA_CARDINAL);
+    case 0:                    /* float */
+        return float_type && pc->format == 32 && pc->type == float_type;
+    }
+    return False;
+}
+
+static double
+prop_cache_value(struct PropCache *pc, struct Parameter *par)
+{
+    switch (par->prop_format) {
+    case 8:
+        return ((char *) pc->data)[par->prop_offset];
+    case 32:
+        return ((long *) pc->data)[par->prop_offset];
+    case 0:                    /* float */
+        return ((union flong *) pc->data)[par->prop_offset].f;
+    }
+    return 0;
+}
+
+static void
+prop_cache_set(struct PropCache *pc, struct Parameter *par, double val)
+{
+    switch (par->prop_format) {
+    case 8:
+        ((char *) pc->data)[par->prop_offset] = rint(val);
+        break;
+    case 32:
+        ((long *) pc->data)[par->prop_offset] = rint(val);
+        break;
+    case 0:                    /* float */
+        ((union flong *) pc->data)[par->prop_offset].f = val;
+        break;
+    }
+    pc->dirty = True;
+}
+
+static int x_errors;
+
+static int
+count_errors(Display * dpy, XErrorEvent * err)
+{
+    x_errors++;
+    return 0;
+}
+
+/* Forget all fetched data, the next prop_cache_get() asks the server again */
+static void
+prop_cache_reset(void)
+{
+    int i;
+
+    for (i = 0; i < prop_cache_size; i++) {
+        if (prop_cache[i].data)
+            XFree(prop_cache[i].data);
+        prop_cache[i].data = NULL;
+        prop_cache[i].fetched = False;
+        prop_cache[i].dirty = False;
+        prop_cache[i].type = None;
+    }
+}
+
+/* Write every modified property once */
+static void
+prop_cache_flush(Display * dpy, XDevice * dev)
+{
+    struct PropCache *pc;
+    int i;
+
+    for (i = 0; i < prop_cache_size; i++) {
+        pc = &prop_cache[i];
+        if (!pc->dirty)
+            continue;
+
+        XChangeDeviceProperty(dpy, dev, pc->atom, pc->type, pc->format,
+                              PropModeReplace, pc->data, pc->nitems);
+        pc->dirty = False;
+    }
+    XFlush(dpy);
+}
+
 /** Init display connection or NULL on error */
 static Display *
 dp_init()
@@ -278,170 +471,918 @@ dp_get_device(Display * dpy)
     return dev;
 }
 
-static void
+struct Setting {
+    struct Parameter *par;
+    double val;
+};
+
+/* Patch the settings into the cached properties first, then write every
+ * modified property once so the driver sees one consistent update per
+ * property. The cache is dropped afterwards, what is read later comes
+ * from the driver. Returns the number of properties the driver rejected. */
+static int
+set_properties(Display * dpy, XDevice * dev, const struct Setting *set,
+               int count)
+{
+    int (*old_handler) (Display *, XErrorEvent *);
+    int i, changed = 0;
+    struct PropCache *pc;
+
+    for (i = 0; i < count; i++) {
+        pc = prop_cache_get(dpy, dev, set[i].par);
+        if (!pc) {
+            fprintf(stderr, "Property for '%s' not available. Skipping.\n",
+                    set[i].par->name);
+            continue;
+        }
+
+        if (!prop_cache_format_ok(pc, set[i].par)) {
+            if (set[i].par->prop_format || float_type)
+                fprintf(stderr, "   %-23s = format mismatch (%d)\n",
+                        set[i].par->name, pc->format);
+            continue;
+        }
+
+        prop_cache_set(pc, set[i].par, set[i].val);
+        changed++;
+    }
+
+    if (!changed)
+        return 0;
+
+    old_handler = XSetErrorHandler(count_errors);
+    x_errors = 0;
+    prop_cache_flush(dpy, dev);
+    XSync(dpy, False);
+    XSetErrorHandler(old_handler);
+
+    prop_cache_reset();
+
+    return x_errors;
+}
+
+/* Apply the var=value arguments. ActiveProfile is written on its own
+ * first: the other properties hold several values each and must be read
+ * from the profile they are written to, or the values not given would be
+ * copied over from the old profile. Returns the number of properties the
+ * driver rejected. */
+static int
 dp_set_variables(Display * dpy, XDevice * dev, int argc, char *argv[],
                  int first_cmd)
 {
-    int i;
-    double val;
-    struct Parameter *par;
-    Atom prop, type, float_type;
-    int format;
-    unsigned char *data;
-    unsigned long nitems, bytes_after;
+    struct Setting *set, profile = { NULL, 0 };
+    int i, count = 0, errors = 0;
 
-    union flong *f;
-    long *n;
-    char *b;
+    if (first_cmd >= argc)
+        return 0;
 
-    float_type = XInternAtom(dpy, XATOM_FLOAT, True);
-    if (!float_type)
-        fprintf(stderr, "Float properties not available.\n");
+    set = calloc(argc - first_cmd, sizeof(*set));
+    if (!set) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
 
     for (i = first_cmd; i < argc; i++) {
-        val = parse_cmd(argv[i], &par);
+        struct Parameter *par;
+        double val = parse_cmd(argv[i], &par);
+
         if (!par)
             continue;
-
-        prop = XInternAtom(dpy, par->prop_name, True);
-        if (!prop) {
-            fprintf(stderr, "Property for '%s' not available. Skipping.\n",
-                    par->name);
+        if (strcmp(par->name, "ActiveProfile") == 0) {
+            /* the last one given wins */
+            profile.par = par;
+            profile.val = val;
             continue;
-
         }
+        set[count].par = par;
+        set[count++].val = val;
+    }
 
-        XGetDeviceProperty(dpy, dev, prop, 0, 1000, False, AnyPropertyType,
-                           &type, &format, &nitems, &bytes_after, &data);
+    if (profile.par) {
+        errors = set_properties(dpy, dev, &profile, 1);
+        if (errors)
+            fprintf(stderr, "The driver rejected ActiveProfile, nothing "
+                    "else set.\n");
+    }
+    if (!errors) {
+        errors = set_properties(dpy, dev, set, count);
+        if (errors)
+            fprintf(stderr, "The driver rejected %d of the changed "
+                    "properties.\n", errors);
+    }
 
-        if (type == None) {
-            fprintf(stderr, "Property for '%s' not available. Skipping.\n",
-                    par->name);
-            continue;
-        }
+    free(set);
 
-        switch (par->prop_format) {
-        case 8:
-            if (format != par->prop_format || type != XA_INTEGER) {
-                fprintf(stderr, "   %-23s = format mismatch (%d)\n",
-                        par->name, format);
-                break;
-            }
-            b = (char *) data;
-            b[par->prop_offset] = rint(val);
-            break;
-        case 32:
-            if (format != par->prop_format ||
-                (type != XA_INTEGER && type != XA_CARDINAL)) {
-                fprintf(stderr, "   %-23s = format mismatch (%d)\n",
-                        par->name, format);
-                break;
-            }
-            n = (long *) data;
-            n[par->prop_offset] = rint(val);
-            break;
-        case 0:                /* float */
-            if (!float_type)
-                continue;
-            if (format != 32 || type != float_type) {
-                fprintf(stderr, "   %-23s = format mismatch (%d)\n",
-                        par->name, format);
-                break;
-            }
-            f = (union flong *) data;
-            f[par->prop_offset].f = val;
-            break;
-        }
-
-        XChangeDeviceProperty(dpy, dev, prop, type, format,
-                              PropModeReplace, data, nitems);
-        XFlush(dpy);
-    }
+    return errors;
 }
 
-/* FIXME: horribly inefficient. */
 static void
 dp_show_settings(Display * dpy, XDevice * dev)
 {
     int j;
-    Atom a, type, float_type;
-    int format;
-    unsigned long nitems, bytes_after;
-    unsigned char *data;
-    int len;
+    struct PropCache *pc;
 
     union flong *f;
     long *i;
     char *b;
 
-    float_type = XInternAtom(dpy, XATOM_FLOAT, True);
-    if (!float_type)
-        fprintf(stderr, "Float properties not available.\n");
-
     printf("Parameter settings:\n");
     for (j = 0; params[j].name; j++) {
         struct Parameter *par = &params[j];
 
-        a = XInternAtom(dpy, par->prop_name, True);
-        if (!a)
-            continue;
-
-        len =
-            1 +
-            ((par->prop_offset * (par->prop_format ? par->prop_format : 32) /
-              8)) / 4;
-
-        XGetDeviceProperty(dpy, dev, a, 0, len, False,
-                           AnyPropertyType, &type, &format,
-                           &nitems, &bytes_after, &data);
-        if (type == None)
+        pc = prop_cache_get(dpy, dev, par);
+        if (!pc)
             continue;
 
         switch (par->prop_format) {
         case 8:
-            if (format != par->prop_format || type != XA_INTEGER) {
+            if (pc->format != par->prop_format || pc->type != XA_INTEGER) {
                 fprintf(stderr, "    %-23s = format mismatch (%d)\n",
-                        par->name, format);
+                        par->name, pc->format);
                 break;
             }
 
-            b = (char *) data;
+            b = (char *) pc->data;
             printf("    %-23s = %d\n", par->name, b[par->prop_offset]);
             break;
         case 32:
-            if (format != par->prop_format ||
-                (type != XA_INTEGER && type != XA_CARDINAL)) {
+            if (pc->format != par->prop_format ||
+                (pc->type != XA_INTEGER && pc->type != XA_CARDINAL)) {
                 fprintf(stderr, "    %-23s = format mismatch (%d)\n",
-                        par->name, format);
+                        par->name, pc->format);
                 break;
             }
 
-            i = (long *) data;
+            i = (long *) pc->data;
             printf("    %-23s = %ld\n", par->name, i[par->prop_offset]);
             break;
         case 0:                /* Float */
             if (!float_type)
                 continue;
-            if (format != 32 || type != float_type) {
+            if (pc->format != 32 || pc->type != float_type) {
                 fprintf(stderr, "    %-23s = format mismatch (%d)\n",
-                        par->name, format);
+                        par->name, pc->format);
                 break;
             }
 
-            f = (union flong *) data;
+            f = (union flong *) pc->data;
             printf("    %-23s = %g\n", par->name, f[par->prop_offset].f);
             break;
         }
+    }
+}
+
+/* All parameters as one flat JSON object, the input format of --apply */
+static void
+dp_dump_json(Display * dpy, XDevice * dev)
+{
+    int j;
+    const char *sep = "";
+
+    printf("{");
+    for (j = 0; params[j].name; j++) {
+        struct Parameter *par = &params[j];
+        struct PropCache *pc = prop_cache_get(dpy, dev, par);
+        double val;
+
+        if (!pc || !prop_cache_format_ok(pc, par))
+            continue;
+
+        val = prop_cache_value(pc, par);
+        printf("%s\n    \"%s\": ", sep, par->name);
+        if (par->type == PT_BOOL)
+            printf("%s", val ? "true" : "false");
+        else if (par->type == PT_INT)
+            printf("%ld", (long) val);
+        else
+            printf("%.9g", val);
+        sep = ",";
+    }
+    printf("\n}\n");
+}
+
+/* Minimal reader for the flat object written by dp_dump_json */
+struct JsonReader {
+    const char *buf;
+    const char *pos;
+    const char *file;
+};
+
+static void
+json_error(struct JsonReader *jr, const char *msg)
+{
+    const char *p;
+    int line = 1;
+
+    for (p = jr->buf; p < jr->pos; p++)
+        if (*p == '\n')
+            line++;
+    fprintf(stderr, "%s:%d: %s\n", jr->file, line, msg);
+}
+
+static char
+json_peek(struct JsonReader *jr)
+{
+    while (isspace((unsigned char) *jr->pos))
+        jr->pos++;
+    return *jr->pos;
+}
+
+static Bool
+json_expect(struct JsonReader *jr, char c)
+{
+    char msg[32];
+
+    if (json_peek(jr) == c) {
+        jr->pos++;
+        return True;
+    }
+    snprintf(msg, sizeof(msg), "expected '%c'", c);
+    json_error(jr, msg);
+    return False;
+}
+
+/* Object key into name, escapes aren't needed for parameter names */
+static Bool
+json_key(struct JsonReader *jr, char *name, size_t len)
+{
+    const char *end;
+
+    if (!json_expect(jr, '"'))
+        return False;
+    end = strchr(jr->pos, '"');
+    if (!end || end - jr->pos >= len || memchr(jr->pos, '\\', end - jr->pos)) {
+        json_error(jr, "invalid parameter name");
+        return False;
+    }
+    memcpy(name, jr->pos, end - jr->pos);
+    name[end - jr->pos] = '\0';
+    jr->pos = end + 1;
+    return True;
+}
+
+static Bool
+json_value(struct JsonReader *jr, double *val)
+{
+    char *end;
+
+    json_peek(jr);
+    if (strncmp(jr->pos, "true", 4) == 0) {
+        jr->pos += 4;
+        *val = 1;
+        return True;
+    }
+    if (strncmp(jr->pos, "false", 5) == 0) {
+        jr->pos += 5;
+        *val = 0;
+        return True;
+    }
+
+    *val = strtod(jr->pos, &end);
+    if (end == jr->pos || !isfinite(*val)) {
+        json_error(jr, "expected a number or boolean");
+        return False;
+    }
+    jr->pos = end;
+    return True;
+}
+
+static char *
+read_file(const char *path)
+{
+    FILE *fp = strcmp(path, "-") ? fopen(path, "r") : stdin;
+    char *buf = NULL;
+    size_t len = 0, size = 0, n;
+
+    if (!fp) {
+        perror(path);
+        return NULL;
+    }
+
+    do {
+        if (size - len < 4096) {
+            char *tmp = realloc(buf, size + 4096 + 1);
+
+            if (!tmp) {
+                fprintf(stderr, "Out of memory.\n");
+                free(buf);
+                buf = NULL;
+                goto out;
+            }
+            buf = tmp;
+            size += 4096;
+        }
+        n = fread(buf + len, 1, size - len, fp);
+        len += n;
+    } while (n > 0);
+
+    if (ferror(fp)) {
+        perror(path);
+        free(buf);
+        buf = NULL;
+        goto out;
+    }
+    buf[len] = '\0';
+
+ out:
+    if (fp != stdin)
+        fclose(fp);
+    return buf;
+}
 
+/* Fetch a 32 bit integer property of exactly count values, NULL if the
+ * driver doesn't have it. Free the result with XFree. */
+static long *
+get_int_property(Display * dpy, XDevice * dev, const char *name, int count)
+{
+    Atom prop, type;
+    int format;
+    unsigned long nitems, bytes_after;
+    unsigned char *data;
+
+    prop = XInternAtom(dpy, name, True);
+    if (!prop)
+        return NULL;
+
+    if (XGetDeviceProperty(dpy, dev, prop, 0, count, False, XA_INTEGER,
+                           &type, &format, &nitems, &bytes_after,
+                           &data) != Success)
+        return NULL;
+    if (type != XA_INTEGER || format != 32 || nitems != count) {
         XFree(data);
+        return NULL;
     }
+
+    return (long *) data;
+}
+
+/* Number of profiles the driver has, 0 if it doesn't know profiles */
+static int
+count_profiles(Display * dpy, XDevice * dev)
+{
+    Atom prop, type;
+    int format, n = 0;
+    unsigned long i, nitems, bytes_after;
+    unsigned char *data;
+
+    prop = XInternAtom(dpy, SYNAPTICS_PROP_PROFILE_NAMES, True);
+    if (!prop)
+        return 0;
+
+    if (XGetDeviceProperty(dpy, dev, prop, 0, 1000, False, XA_STRING,
+                           &type, &format, &nitems, &bytes_after,
+                           &data) != Success)
+        return 0;
+    if (type == XA_STRING && format == 8)
+        for (i = 0; i < nitems; i++)
+            if (data[i] == '\0')
+                n++;
+    XFree(data);
+
+    return n;
+}
+
+/* Where each parameter lives in SYNAPTICS_PROP_PARAM_BLOCK. TouchpadOff and
+ * ActiveProfile aren't tuning and have properties of their own. */
+static const struct {
+    const char *name;
+    int index;
+} pb_index[] = {
+    {"FingerLow", SYNAPTICS_PB_FINGER_LOW},
+    {"FingerHigh", SYNAPTICS_PB_FINGER_HIGH},
+    {"MaxTapTime", SYNAPTICS_PB_TAP_TIME},
+    {"MaxTapMove", SYNAPTICS_PB_TAP_MOVE},
+    {"VertScrollDelta", SYNAPTICS_PB_SCROLL_DIST_VERT},
+    {"HorizScrollDelta", SYNAPTICS_PB_SCROLL_DIST_HORIZ},
+    {"VertTwoFingerScroll", SYNAPTICS_PB_SCROLL_TWOFINGER_VERT},
+    {"HorizTwoFingerScroll", SYNAPTICS_PB_SCROLL_TWOFINGER_HORIZ},
+    {"MinSpeed", SYNAPTICS_PB_MIN_SPEED},
+    {"MaxSpeed", SYNAPTICS_PB_MAX_SPEED},
+    {"AccelFactor", SYNAPTICS_PB_ACCEL_FACTOR},
+    {"PressureMotionMinZ", SYNAPTICS_PB_PRESSURE_MOTION_MIN_Z},
+    {"PressureMotionMaxZ", SYNAPTICS_PB_PRESSURE_MOTION_MAX_Z},
+    {"PressureMotionMinFactor", SYNAPTICS_PB_PRESSURE_MOTION_MIN_FACTOR},
+    {"PressureMotionMaxFactor", SYNAPTICS_PB_PRESSURE_MOTION_MAX_FACTOR},
+    {"GrabEventDevice", SYNAPTICS_PB_GRAB},
+    {"HorizHysteresis", SYNAPTICS_PB_HYST_X},
+    {"VertHysteresis", SYNAPTICS_PB_HYST_Y},
+    {"ClickPad", SYNAPTICS_PB_CLICKPAD},
+    {"BottomButtonsHeight", SYNAPTICS_PB_BOTTOM_BUTTONS_HEIGHT},
+    {"BottomButtonsSepPos", SYNAPTICS_PB_BOTTOM_BUTTONS_SEP_POS},
+    {"BottomButtonsSepWidth", SYNAPTICS_PB_BOTTOM_BUTTONS_SEP_WIDTH},
+    {"TopButtonsHeight", SYNAPTICS_PB_TOP_BUTTONS_HEIGHT},
+    {"TopButtonsMiddleWidth", SYNAPTICS_PB_TOP_BUTTONS_MIDDLE_WIDTH},
+    {"TwoFingerScrollFingerSize", SYNAPTICS_PB_TWOFINGER_FINGER_SIZE},
+    {"MinTapPressure", SYNAPTICS_PB_TAP_PRESSURE},
+    {"TapAnywhere", SYNAPTICS_PB_TAP_ANYWHERE},
+    {"TapHoldGesture", SYNAPTICS_PB_TAP_HOLD},
+    {"TypingTimeout", SYNAPTICS_PB_TYPING_TIMEOUT},
+    {NULL, 0}
+};
+
+static int
+block_index(const struct Parameter *par)
+{
+    int i;
+
+    for (i = 0; pb_index[i].name; i++)
+        if (strcmp(pb_index[i].name, par->name) == 0)
+            return pb_index[i].index;
+    return -1;
+}
+
+static float
+pb_float(long v)
+{
+    union { float f; uint32_t i; } u;
+
+    u.i = v;
+    return u.f;
+}
+
+static long
+float_pb(float f)
+{
+    union { float f; uint32_t i; } u;
+
+    u.f = f;
+    return (int32_t) u.i;
+}
+
+/* The driver's checks across values of the block, so a file it would
+ * reject fails with a message instead of an X error */
+static const char *
+check_block(const long *pb)
+{
+    if (pb[SYNAPTICS_PB_FINGER_LOW] > pb[SYNAPTICS_PB_FINGER_HIGH])
+        return "FingerLow is above FingerHigh";
+    if (pb[SYNAPTICS_PB_SCROLL_DIST_VERT] == 0 ||
+        pb[SYNAPTICS_PB_SCROLL_DIST_HORIZ] == 0)
+        return "a scroll delta is 0";
+    if (pb[SYNAPTICS_PB_PRESSURE_MOTION_MIN_Z] >
+        pb[SYNAPTICS_PB_PRESSURE_MOTION_MAX_Z])
+        return "PressureMotionMinZ is above PressureMotionMaxZ";
+    if (pb_float(pb[SYNAPTICS_PB_PRESSURE_MOTION_MIN_FACTOR]) >
+        pb_float(pb[SYNAPTICS_PB_PRESSURE_MOTION_MAX_FACTOR]))
+        return "PressureMotionMinFactor is above PressureMotionMaxFactor";
+    return NULL;
+}
+
+/*
+ * Apply the parameters in a file written by --dump=json. Everything is
+ * parsed and checked against the params[] limits and the driver's own rules
+ * first; if anything is wrong nothing is sent. The tunables go to the driver
+ * in one parameter block write, which it applies completely or not at all.
+ * With ActiveProfile the profile is switched first so the block is based
+ * on the values of the new profile, and switched back if the block is
+ * rejected. TouchpadOff is written last. Returns 0 on success.
+ */
+static int
+dp_apply(Display * dpy, XDevice * dev, const char *path)
+{
+    struct JsonReader jr;
+    struct {
+        struct Parameter *par;
+        double val;
+    } vals[sizeof(params) / sizeof(params[0])];
+    int nvals = 0;
+    int (*old_handler) (Display *, XErrorEvent *);
+    Atom block_atom, profile_atom, off_atom;
+    long *pb = NULL, *old_profile = NULL;
+    long profile = -1, off = -1;
+    const char *msg;
+    char *buf;
+    int i, ret = 1;
+
+    buf = read_file(path);
+    if (!buf)
+        return 1;
+
+    jr.buf = jr.pos = buf;
+    jr.file = strcmp(path, "-") ? path : "<stdin>";
+
+    if (!json_expect(&jr, '{'))
+        goto out;
+
+    if (json_peek(&jr) != '}') {
+        for (;;) {
+            char name[64], msg[128];
+            struct Parameter *par;
+            double val;
+
+            if (!json_key(&jr, name, sizeof(name)) ||
+                !json_expect(&jr, ':') || !json_value(&jr, &val))
+                goto out;
+
+            for (par = params; par->name; par++)
+                if (strcasecmp(name, par->name) == 0)
+                    break;
+            if (!par->name) {
+                snprintf(msg, sizeof(msg), "unknown parameter %s", name);
+                json_error(&jr, msg);
+                goto out;
+            }
+
+            if (val < par->min_val || val > par->max_val ||
+                (par->type != PT_DOUBLE && val != rint(val))) {
+                snprintf(msg, sizeof(msg), "%s = %g out of range [%g, %g]",
+                         par->name, val, par->min_val, par->max_val);
+                json_error(&jr, msg);
+                goto out;
+            }
+
+            /* a repeated parameter overrides the earlier value */
+            for (i = 0; i < nvals; i++)
+                if (vals[i].par == par)
+                    break;
+            if (i == nvals)
+                nvals++;
+            vals[i].par = par;
+            vals[i].val = val;
+
+            if (json_peek(&jr) != ',')
+                break;
+            jr.pos++;
+        }
+    }
+
+    if (!json_expect(&jr, '}'))
+        goto out;
+    if (json_peek(&jr) != '\0') {
+        json_error(&jr, "trailing data after object");
+        goto out;
+    }
+
+    block_atom = XInternAtom(dpy, SYNAPTICS_PROP_PARAM_BLOCK, True);
+    profile_atom = XInternAtom(dpy, SYNAPTICS_PROP_ACTIVE_PROFILE, True);
+    off_atom = XInternAtom(dpy, SYNAPTICS_PROP_OFF, True);
+
+    for (i = 0; i < nvals; i++) {
+        if (strcmp(vals[i].par->name, "ActiveProfile") == 0)
+            profile = vals[i].val;
+        else if (strcmp(vals[i].par->name, "TouchpadOff") == 0)
+            off = vals[i].val;
+    }
+
+    if (profile >= 0) {
+        old_profile = profile_atom ?
+            get_int_property(dpy, dev, SYNAPTICS_PROP_ACTIVE_PROFILE, 1) : NULL;
+        if (!old_profile || profile >= count_profiles(dpy, dev)) {
+            fprintf(stderr, "ActiveProfile = %ld: no such profile.\n", profile);
+            goto out;
+        }
+        if (profile == old_profile[0])
+            profile = -1;
+    }
+    if (off >= 0 && !off_atom) {
+        fprintf(stderr, "Property for 'TouchpadOff' not available.\n");
+        goto out;
+    }
+
+    old_handler = XSetErrorHandler(count_errors);
+    x_errors = 0;
+
+    /* the block must come from the profile it is applied to */
+    if (profile >= 0) {
+        XChangeDeviceProperty(dpy, dev, profile_atom, XA_INTEGER, 32,
+                              PropModeReplace, (unsigned char *) &profile, 1);
+        XSync(dpy, False);
+        if (x_errors) {
+            fprintf(stderr, "The driver rejected ActiveProfile, nothing applied.\n");
+            goto done;
+        }
+    }
+
+    pb = get_int_property(dpy, dev, SYNAPTICS_PROP_PARAM_BLOCK,
+                          SYNAPTICS_PB_COUNT);
+    if (!pb || pb[SYNAPTICS_PB_LAYOUT_VERSION] != SYNAPTICS_PB_VERSION) {
+        fprintf(stderr, "The driver has no usable parameter block.\n");
+        goto restore;
+    }
+
+    for (i = 0; i < nvals; i++) {
+        int index = block_index(vals[i].par);
+
+        if (index < 0)
+            continue;
+        if (vals[i].par->type == PT_DOUBLE)
+            pb[index] = float_pb(vals[i].val);
+        else
+            pb[index] = rint(vals[i].val);
+    }
+
+    msg = check_block(pb);
+    if (msg) {
+        fprintf(stderr, "%s: %s, nothing applied.\n", jr.file, msg);
+        goto restore;
+    }
+
+    XChangeDeviceProperty(dpy, dev, block_atom, XA_INTEGER, 32,
+                          PropModeReplace, (unsigned char *) pb,
+                          SYNAPTICS_PB_COUNT);
+    XSync(dpy, False);
+    if (x_errors) {
+        fprintf(stderr, "The driver rejected the parameters, nothing applied.\n");
+        goto restore;
+    }
+
+    if (off >= 0) {
+        unsigned char value = off;
+
+        XChangeDeviceProperty(dpy, dev, off_atom, XA_INTEGER, 8,
+                              PropModeReplace, &value, 1);
+        XSync(dpy, False);
+        if (x_errors) {
+            fprintf(stderr, "The driver rejected TouchpadOff.\n");
+            goto done;
+        }
+    }
+
+    ret = 0;
+    goto done;
+
+ restore:
+    if (profile >= 0) {
+        XChangeDeviceProperty(dpy, dev, profile_atom, XA_INTEGER, 32,
+                              PropModeReplace, (unsigned char *) old_profile, 1);
+        XSync(dpy, False);
+    }
+ done:
+    XSetErrorHandler(old_handler);
+ out:
+    if (pb)
+        XFree(pb);
+    if (old_profile)
+        XFree(old_profile);
+    free(buf);
+    return ret;
+}
+
+static long
+monotonic_millis(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void
+monitor_print(const long *state)
+{
+    int i;
+
+    printf("%8.3f %3ld %3ld %2ld", state[SYNAPTICS_MON_TIME] / 1000.0,
+           state[SYNAPTICS_MON_BUTTONS], state[SYNAPTICS_MON_SCROLL],
+           state[SYNAPTICS_MON_TOUCHES]);
+    for (i = 0; i < SYNAPTICS_MON_MAX_TOUCHES; i++) {
+        const long *t = state + SYNAPTICS_MON_TOUCH_BASE +
+            i * SYNAPTICS_MON_TOUCH_SIZE;
+
+        printf(" | %5ld %5ld %3ld %4ld %3ld", t[SYNAPTICS_MON_TOUCH_X],
+               t[SYNAPTICS_MON_TOUCH_Y], t[SYNAPTICS_MON_TOUCH_Z],
+               t[SYNAPTICS_MON_TOUCH_AREA], t[SYNAPTICS_MON_TOUCH_TAP]);
+    }
+    printf("\n");
+}
+
+static void
+monitor_set(Display * dpy, XDevice * dev, Atom control, long interval,
+            long lease)
+{
+    long values[2];
+
+    values[0] = interval;
+    values[1] = lease;
+    XChangeDeviceProperty(dpy, dev, control, XA_INTEGER, 32,
+                          PropModeReplace, (unsigned char *) values, 2);
+    XFlush(dpy);
+}
+
+/* Consistent copy of the driver's shared memory, see synaptics-shm.h */
+static void
+shm_read(const struct SynapticsShm *shm, struct SynapticsShm *copy)
+{
+    uint32_t seq;
+
+    do {
+        while ((seq = shm->seq) & 1)
+            ;
+        __sync_synchronize();
+        memcpy(copy, (const void *) shm, sizeof(*copy));
+        __sync_synchronize();
+    } while (shm->seq != seq);
+}
+
+/*
+ * Monitor through the driver's shared memory if the SharedMemory option is
+ * on. Reading costs the driver nothing, so this simply samples every
+ * interval and prints when a new frame was handled. Returns False if the
+ * segment isn't available.
+ */
+static Bool
+dp_monitor_shm(XDevice * dev, int interval)
+{
+    const struct SynapticsShm *shm;
+    struct SynapticsShm cur;
+    uint32_t last_frame = 0;
+    char name[32];
+    int fd;
+
+    snprintf(name, sizeof(name), SYNAPTICS_SHM_NAME, (int) dev->device_id);
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return False;
+
+    shm = mmap(NULL, sizeof(*shm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED)
+        return False;
+
+    if (shm->magic != SYNAPTICS_SHM_MAGIC ||
+        shm->version < SYNAPTICS_SHM_VERSION) {
+        fprintf(stderr, "Unknown shared memory layout in %s.\n", name);
+        munmap((void *) shm, sizeof(*shm));
+        return False;
+    }
+
+    printf("    time btn scr  n |     x     y   z area tap"
+           " |     x     y   z area tap\n");
+
+    for (;;) {
+        long state[SYNAPTICS_MON_COUNT];
+        int i;
+
+        shm_read(shm, &cur);
+        if (cur.frames != last_frame) {
+            last_frame = cur.frames;
+
+            state[SYNAPTICS_MON_TIME] = cur.time;
+            state[SYNAPTICS_MON_BUTTONS] = cur.buttons;
+            state[SYNAPTICS_MON_SCROLL] = cur.scroll;
+            state[SYNAPTICS_MON_TOUCHES] = cur.touches;
+            for (i = 0; i < SYNAPTICS_MON_MAX_TOUCHES &&
+                 i < SYNAPTICS_SHM_MAX_TOUCHES; i++) {
+                long *t = state + SYNAPTICS_MON_TOUCH_BASE +
+                    i * SYNAPTICS_MON_TOUCH_SIZE;
+
+                t[SYNAPTICS_MON_TOUCH_X] = cur.touch[i].x;
+                t[SYNAPTICS_MON_TOUCH_Y] = cur.touch[i].y;
+                t[SYNAPTICS_MON_TOUCH_Z] = cur.touch[i].z;
+                t[SYNAPTICS_MON_TOUCH_AREA] = cur.touch[i].area;
+                t[SYNAPTICS_MON_TOUCH_TAP] = cur.touch[i].tap_state;
+            }
+            monitor_print(state);
+            fflush(stdout);
+        }
+
+        usleep(interval * 1000);
+    }
+
+    return True;
+}
+
+/*
+ * Print the driver's post-filter state whenever it changes. The driver only
+ * records it while the lease written to the control property is valid, so
+ * it is renewed periodically and expires on its own if synclient dies.
+ */
+static void
+dp_monitor(Display * dpy, XDevice * dev, int interval)
+{
+    Atom control, state;
+    XEventClass evclass;
+    int event_type;
+    struct pollfd pfd;
+    long lease, renew;
+
+    if (dp_monitor_shm(dev, interval))
+        return;
+
+    control = XInternAtom(dpy, SYNAPTICS_PROP_MONITOR_CONTROL, True);
+    state = XInternAtom(dpy, SYNAPTICS_PROP_MONITOR_STATE, True);
+    if (!control || !state) {
+        fprintf(stderr, "Monitoring not supported by the driver.\n");
+        return;
+    }
+
+    DevicePropertyNotify(dev, event_type, evclass);
+    XSelectExtensionEvent(dpy, DefaultRootWindow(dpy), &evclass, 1);
+
+    lease = interval * 4 > 2000 ? interval * 4 : 2000;
+    monitor_set(dpy, dev, control, interval, lease);
+    renew = monotonic_millis() + lease / 2;
+
+    printf("    time btn scr  n |     x     y   z area tap"
+           " |     x     y   z area tap\n");
+
+    pfd.fd = ConnectionNumber(dpy);
+    pfd.events = POLLIN;
+
+    for (;;) {
+        long now = monotonic_millis();
+
+        if (now >= renew) {
+            monitor_set(dpy, dev, control, interval, lease);
+            renew = now + lease / 2;
+        }
+
+        if (!XPending(dpy)) {
+            poll(&pfd, 1, renew - now);
+            continue;
+        }
+
+        while (XPending(dpy)) {
+            XEvent ev;
+            XDevicePropertyNotifyEvent *pev = (XDevicePropertyNotifyEvent *) & ev;
+            Atom type;
+            int format;
+            unsigned long nitems, bytes_after;
+            unsigned char *data;
+
+            XNextEvent(dpy, &ev);
+            if (ev.type != event_type || pev->atom != state)
+                continue;
+
+            if (XGetDeviceProperty(dpy, dev, state, 0, SYNAPTICS_MON_COUNT,
+                                   False, XA_INTEGER, &type, &format, &nitems,
+                                   &bytes_after, &data) != Success)
+                continue;
+            if (type == XA_INTEGER && format == 32 &&
+                nitems == SYNAPTICS_MON_COUNT)
+                monitor_print((long *) data);
+            XFree(data);
+        }
+        fflush(stdout);
+    }
+}
+
+/* Print the driver's counters and the latency histogram */
+static void
+dp_show_counters(Display * dpy, XDevice * dev)
+{
+    static const char *names[SYNAPTICS_CNT_COUNT] = {
+        [SYNAPTICS_CNT_EVENTS] = "EventsRead",
+        [SYNAPTICS_CNT_FRAMES] = "Frames",
+        [SYNAPTICS_CNT_DROPPED] = "SynDropped",
+        [SYNAPTICS_CNT_RESYNCS] = "ResyncFrames",
+        [SYNAPTICS_CNT_OFF_FRAMES] = "FramesWhileOff",
+        [SYNAPTICS_CNT_MOTION_POSTS] = "MotionPosts",
+        [SYNAPTICS_CNT_BUTTON_POSTS] = "ButtonPosts",
+        [SYNAPTICS_CNT_SCROLL_POSTS] = "ScrollPosts",
+        [SYNAPTICS_CNT_TIMER_ARMS] = "TimerArms",
+        [SYNAPTICS_CNT_TIMER_CANCELS] = "TimerCancels",
+        [SYNAPTICS_CNT_TIMER_FIRES] = "TimerFires",
+        [SYNAPTICS_CNT_JUMPS] = "JumpsDiscarded",
+        [SYNAPTICS_CNT_CLICK_TAPS] = "TapsAfterClick",
+    };
+    long *values;
+    int i;
+
+    values = get_int_property(dpy, dev, SYNAPTICS_PROP_COUNTERS, SYNAPTICS_CNT_COUNT);
+    if (!values) {
+        fprintf(stderr, "Counters not supported by the driver.\n");
+        return;
+    }
+
+    printf("Counters:\n");
+    for (i = 0; i < SYNAPTICS_CNT_COUNT; i++)
+        printf("    %-23s = %lu\n", names[i], values[i] & 0xffffffffUL);
+    XFree(values);
+
+    values = get_int_property(dpy, dev, SYNAPTICS_PROP_LATENCY, SYNAPTICS_LAT_COUNT);
+    if (!values)
+        return;
+
+    printf("Frame latency:\n");
+    for (i = 0; i < SYNAPTICS_LAT_COUNT; i++) {
+        char range[32];
+
+        if (i == 0)
+            snprintf(range, sizeof(range), "< 1 ms");
+        else if (i == SYNAPTICS_LAT_COUNT - 1)
+            snprintf(range, sizeof(range), ">= %d ms", 1 << (i - 1));
+        else if (i == 1)
+            snprintf(range, sizeof(range), "1 ms");
+        else
+            snprintf(range, sizeof(range), "%d-%d ms", 1 << (i - 1),
+                     (1 << i) - 1);
+        printf("    %-23s = %lu\n", range, values[i] & 0xffffffffUL);
+    }
+    XFree(values);
 }
 
 static void
 usage(void)
 {
-    fprintf(stderr, "Usage: synclient [-h] [-l] [-V] [-?] [var1=value1 [var2=value2] ...]\n");
+    fprintf(stderr, "Usage: synclient [-h] [-l] [-c] [-m interval] [-V] [-?] [--dump=json] [--apply file] [var1=value1 [var2=value2] ...]\n");
     fprintf(stderr, "  -l List current user settings\n");
+    fprintf(stderr, "  -c Show the driver's counters and frame latency histogram\n");
+    fprintf(stderr, "  --dump=json Print all settings as a JSON object\n");
+    fprintf(stderr, "  --apply file Apply all settings in a file written by --dump=json,\n");
+    fprintf(stderr, "     or none if any of them is invalid. '-' reads standard input\n");
+    fprintf(stderr, "  -m interval Monitor the touchpad state, updated at most every\n");
+    fprintf(stderr, "     interval milliseconds\n");
     fprintf(stderr, "  -V Print synclient version string and exit\n");
     fprintf(stderr, "  -? Show this help message\n");
     fprintf(stderr, "  var=value  Set user parameter 'var' to 'value'.\n");
@@ -453,7 +1394,17 @@ main(int argc, char *argv[])
 {
     int c;
     int dump_settings = 0;
+    int show_counters = 0;
+    int monitor_interval = 0;
+    int dump_json = 0;
+    const char *apply_file = NULL;
     int first_cmd;
+    int ret = 0;
+    static const struct option long_options[] = {
+        {"dump", required_argument, NULL, 'd'},
+        {"apply", required_argument, NULL, 'a'},
+        {NULL, 0, NULL, 0}
+    };
 
     Display *dpy;
     XDevice *dev;
@@ -462,11 +1413,27 @@ main(int argc, char *argv[])
         dump_settings = 1;
 
     /* Parse command line parameters */
-    while ((c = getopt(argc, argv, "lV?")) != -1) {
+    while ((c = getopt_long(argc, argv, "lcm:V?", long_options, NULL)) != -1) {
         switch (c) {
+        case 'd':
+            if (strcmp(optarg, "json") != 0)
+                usage();
+            dump_json = 1;
+            break;
+        case 'a':
+            apply_file = optarg;
+            break;
         case 'l':
             dump_settings = 1;
             break;
+        case 'c':
+            show_counters = 1;
+            break;
+        case 'm':
+            monitor_interval = atoi(optarg);
+            if (monitor_interval <= 0)
+                usage();
+            break;
         case 'V':
             printf("%s\n", VERSION);
             exit(0);
@@ -477,19 +1444,33 @@ main(int argc, char *argv[])
     }
 
     first_cmd = optind;
-    if (!dump_settings && first_cmd == argc)
+    if (!dump_settings && !show_counters && !monitor_interval && !dump_json &&
+        !apply_file && first_cmd == argc)
         usage();
 
     dpy = dp_init();
     if (!dpy || !(dev = dp_get_device(dpy)))
         return 1;
 
-    dp_set_variables(dpy, dev, argc, argv, first_cmd);
+    prop_cache_init(dpy);
+
+    if (apply_file)
+        ret = dp_apply(dpy, dev, apply_file);
+    if (ret == 0 && dp_set_variables(dpy, dev, argc, argv, first_cmd))
+        ret = 1;
+    if (dump_json)
+        dp_dump_json(dpy, dev);
     if (dump_settings)
         dp_show_settings(dpy, dev);
+    if (show_counters)
+        dp_show_counters(dpy, dev);
+    if (monitor_interval)
+        dp_monitor(dpy, dev, monitor_interval);
+
+    prop_cache_free();
 
     XCloseDevice(dpy, dev);
     XCloseDisplay(dpy);
 
-    return 0;
+    return ret;
 }
@@ -31,10 +31,14 @@
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
 #include <X11/extensions/XInput.h>
+#include <X11/extensions/XIproto.h>
 #ifdef HAVE_X11_EXTENSIONS_RECORD_H
 #include <X11/Xproto.h>
 #include <X11/extensions/record.h>
 #endif                          /* HAVE_X11_EXTENSIONS_RECORD_H */
+#ifdef HAVE_X11_EXTENSIONS_XINPUT2_H
+#include <X11/extensions/XInput2.h>
+#endif                          /* HAVE_X11_EXTENSIONS_XINPUT2_H */
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -42,8 +46,16 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <signal.h>
-#include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <time.h>
+#include <limits.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <linux/input.h>
 
 #include "synaptics-properties.h"
 
@@ -60,15 +72,30 @@ static int ignore_modifier_keys;
 static int background;
 static const char *pid_file;
 static Display *display;
-static XDevice *dev;
 static Atom touchpad_off_prop;
-static enum TouchpadState previous_state;
+static int property_event_type;
+static int xi_opcode;
+static int xi_error_base;
 static enum TouchpadState disable_state = TouchpadOff;
 static int verbose;
 
 #define KEYMAP_SIZE 32
 static unsigned char keyboard_mask[KEYMAP_SIZE];
 
+#define MAX_TOUCHPADS 8
+#define MAX_PENDING 4
+
+struct Touchpad {
+    XDevice *dev;
+    enum TouchpadState previous_state;  /* "Synaptics Off" to go back to */
+    Bool disabled;              /* we wrote disable_state */
+    int pending_writes;         /* our own writes not yet notified */
+    unsigned long pending_serial[MAX_PENDING];  /* their requests, oldest first */
+};
+
+static struct Touchpad touchpads[MAX_TOUCHPADS];
+static int num_touchpads;
+
 static void
 usage(void)
 {
@@ -87,55 +114,331 @@ usage(void)
             "  -k Ignore modifier keys when monitoring keyboard activity.\n");
     fprintf(stderr, "  -K Like -k but also ignore Modifier+Key combos.\n");
     fprintf(stderr, "  -R Use the XRecord extension.\n");
+    fprintf(stderr, "  -X Use XInput 2 raw key events.\n");
+    fprintf(stderr, "  -E Read the keyboard event devices directly.\n");
     fprintf(stderr, "  -v Print diagnostic messages.\n");
     fprintf(stderr, "  -? Show this help message.\n");
     exit(1);
 }
 
 static void
-store_current_touchpad_state(void)
+store_current_touchpad_state(struct Touchpad *tp)
 {
     Atom real_type;
     int real_format;
     unsigned long nitems, bytes_after;
     unsigned char *data;
 
-    if ((XGetDeviceProperty(display, dev, touchpad_off_prop, 0, 1, False,
+    if ((XGetDeviceProperty(display, tp->dev, touchpad_off_prop, 0, 1, False,
                             XA_INTEGER, &real_type, &real_format, &nitems,
                             &bytes_after, &data) == Success) &&
         (real_type != None)) {
-        previous_state = data[0];
+        tp->previous_state = data[0];
+        XFree(data);
+    }
+}
+
+static struct Touchpad *
+find_touchpad(XID id)
+{
+    int i;
+
+    for (i = 0; i < num_touchpads; i++)
+        if (touchpads[i].dev->device_id == id)
+            return &touchpads[i];
+    return NULL;
+}
+
+/* Start managing a device if it is a synaptics touchpad */
+static Bool
+add_touchpad(XDeviceInfo * info)
+{
+    struct Touchpad *tp;
+    XEventClass evclass;
+    XDevice *dev;
+    Atom *properties;
+    int nprops = 0;
+
+    if (num_touchpads == MAX_TOUCHPADS || find_touchpad(info->id))
+        return False;
+
+    dev = XOpenDevice(display, info->id);
+    if (!dev) {
+        fprintf(stderr, "Failed to open device '%s'.\n", info->name);
+        return False;
+    }
+
+    properties = XListDeviceProperties(display, dev, &nprops);
+    while (nprops--) {
+        if (properties[nprops] == touchpad_off_prop)
+            break;
+    }
+    XFree(properties);
+    if (nprops < 0) {
+        if (verbose)
+            printf("No synaptics properties on device '%s'.\n", info->name);
+        XCloseDevice(display, dev);
+        return False;
+    }
+
+    tp = &touchpads[num_touchpads++];
+    tp->dev = dev;
+    tp->previous_state = TouchpadOn;
+    tp->disabled = False;
+    tp->pending_writes = 0;
+
+    /* Watch "Synaptics Off" so the cached state never needs to be re-read */
+    DevicePropertyNotify(dev, property_event_type, evclass);
+    XSelectExtensionEvent(display, DefaultRootWindow(display), &evclass, 1);
+    store_current_touchpad_state(tp);
+
+    if (verbose)
+        printf("Managing touchpad '%s'\n", info->name);
+    return True;
+}
+
+static void
+remove_touchpad(XID id)
+{
+    struct Touchpad *tp = find_touchpad(id);
+
+    if (!tp)
+        return;
+
+    if (verbose)
+        printf("Touchpad %lu removed\n", (unsigned long) id);
+
+    XCloseDevice(display, tp->dev);
+    *tp = touchpads[--num_touchpads];
+}
+
+/* Add all synaptics touchpads not managed yet. Returns the number of
+ * managed touchpads. */
+static int
+scan_touchpads(void)
+{
+    XDeviceInfo *info;
+    Atom touchpad_type;
+    int ndevices = 0;
+
+    touchpad_type = XInternAtom(display, XI_TOUCHPAD, True);
+    info = XListInputDevices(display, &ndevices);
+
+    while (ndevices--) {
+        if (info[ndevices].type == touchpad_type)
+            add_touchpad(&info[ndevices]);
+    }
+
+    XFreeDeviceList(info);
+    return num_touchpads;
+}
+
+/* Remember a write of "Synaptics Off" made by the request with serial */
+static void
+add_pending_write(struct Touchpad *tp, unsigned long serial)
+{
+    /* notifications that never came, forget the oldest */
+    if (tp->pending_writes == MAX_PENDING) {
+        memmove(tp->pending_serial, tp->pending_serial + 1,
+                (MAX_PENDING - 1) * sizeof(tp->pending_serial[0]));
+        tp->pending_writes--;
+    }
+    tp->pending_serial[tp->pending_writes++] = serial;
+}
+
+/* Forget the write made by the request with serial, once it is notified or
+ * failed */
+static void
+drop_pending_write(unsigned long serial)
+{
+    int i, j;
+
+    for (i = 0; i < num_touchpads; i++) {
+        struct Touchpad *tp = &touchpads[i];
+
+        for (j = 0; j < tp->pending_writes; j++) {
+            if (tp->pending_serial[j] != serial)
+                continue;
+            memmove(tp->pending_serial + j, tp->pending_serial + j + 1,
+                    (tp->pending_writes - j - 1) * sizeof(tp->pending_serial[0]));
+            tp->pending_writes--;
+            return;
+        }
+    }
+}
+
+/* BadDevice is expected when a touchpad is unplugged while we talk to it,
+ * everything else is fatal as usual. */
+static int (*default_error_handler) (Display *, XErrorEvent *);
+
+static int
+error_handler(Display * dpy, XErrorEvent * err)
+{
+    if (!xi_opcode || err->request_code != xi_opcode)
+        return default_error_handler(dpy, err);
+
+    /* a failed write is never notified */
+    if (err->minor_code == X_ChangeDeviceProperty)
+        drop_pending_write(err->serial);
+
+    if (err->error_code == xi_error_base + XI_BadDevice) {
+        if (verbose)
+            printf("Ignoring error for a removed device\n");
+        return 0;
+    }
+    return default_error_handler(dpy, err);
+}
+
+/**
+ * Keep previous_state in sync with "Synaptics Off". Notifications for our
+ * own writes carry no news. Any other change comes from a different client,
+ * its value becomes the state to go back to and the touchpad is no longer
+ * ours to re-enable.
+ */
+static void
+handle_property_event(XEvent * ev)
+{
+    XDevicePropertyNotifyEvent *pev = (XDevicePropertyNotifyEvent *) ev;
+    struct Touchpad *tp;
+
+    if (ev->type != property_event_type || pev->atom != touchpad_off_prop)
+        return;
+
+    tp = find_touchpad(pev->deviceid);
+    if (!tp)
+        return;
+
+    if (tp->pending_writes > 0) {
+        drop_pending_write(tp->pending_serial[0]);
+        return;
     }
+
+    store_current_touchpad_state(tp);
+    if (tp->disabled && verbose)
+        printf("Touchpad state changed by another client\n");
+    tp->disabled = False;
+}
+
+#ifdef HAVE_X11_EXTENSIONS_XINPUT2_H
+/* test if the server supports XI 2.0 */
+static Bool
+check_xi2(Display * display)
+{
+    int major = 2, minor = 0;
+
+    if (!xi_opcode || XIQueryVersion(display, &major, &minor) != Success)
+        return False;
+
+    if (verbose)
+        printf("X Input extension version %d.%d\n", major, minor);
+    return True;
+}
+
+/* Select hierarchy changes for hotplug, and raw key events for -X */
+static void
+select_xi2_events(Bool raw_keys)
+{
+    unsigned char mask[XIMaskLen(XI_LASTEVENT)] = { 0 };
+    XIEventMask evmask;
+
+    XISetMask(mask, XI_HierarchyChanged);
+    if (raw_keys) {
+        XISetMask(mask, XI_RawKeyPress);
+        XISetMask(mask, XI_RawKeyRelease);
+    }
+    evmask.deviceid = XIAllDevices;
+    evmask.mask_len = sizeof(mask);
+    evmask.mask = mask;
+    XISelectEvents(display, DefaultRootWindow(display), &evmask, 1);
+    XFlush(display);
+}
+
+static void
+handle_hierarchy_event(XIHierarchyEvent * hev)
+{
+    int i;
+
+    for (i = 0; i < hev->num_info; i++)
+        if (hev->info[i].flags & XISlaveRemoved)
+            remove_touchpad(hev->info[i].deviceid);
+
+    if (hev->flags & (XISlaveAdded | XIDeviceEnabled))
+        scan_touchpads();
+}
+
+static Bool
+is_hierarchy_event(Display * dpy, XEvent * ev, XPointer arg)
+{
+    return ev->xcookie.type == GenericEvent &&
+        ev->xcookie.extension == xi_opcode &&
+        ev->xcookie.evtype == XI_HierarchyChanged;
+}
+#endif                          /* HAVE_X11_EXTENSIONS_XINPUT2_H */
+
+/* Process property and hierarchy notifications queued on the connection,
+ * leaving all other events alone. */
+static void
+process_device_events(void)
+{
+    XEvent ev;
+
+    while (XCheckTypedEvent(display, property_event_type, &ev))
+        handle_property_event(&ev);
+
+#ifdef HAVE_X11_EXTENSIONS_XINPUT2_H
+    while (XCheckIfEvent(display, &ev, is_hierarchy_event, NULL)) {
+        if (XGetEventData(display, &ev.xcookie)) {
+            handle_hierarchy_event(ev.xcookie.data);
+            XFreeEventData(display, &ev.xcookie);
+        }
+    }
+#endif                          /* HAVE_X11_EXTENSIONS_XINPUT2_H */
 }
 
 /**
- * Toggle touchpad enabled/disabled state, decided by value.
+ * Toggle touchpad enabled/disabled state, decided by value. All touchpads
+ * change together with a single flush.
  */
 static void
 toggle_touchpad(Bool enable)
 {
     unsigned char data;
+    int i, writes = 0;
 
-    if (pad_disabled && enable) {
-        data = previous_state;
-        pad_disabled = False;
-        if (verbose)
-            printf("Enable\n");
-    }
-    else if (!pad_disabled && !enable &&
-             previous_state != disable_state && previous_state != TouchpadOff) {
-        store_current_touchpad_state();
-        pad_disabled = True;
-        data = disable_state;
-        if (verbose)
-            printf("Disable\n");
+    process_device_events();
+
+    if (enable != pad_disabled)
+        return;
+    pad_disabled = !enable;
+
+    for (i = 0; i < num_touchpads; i++) {
+        struct Touchpad *tp = &touchpads[i];
+
+        if (enable) {
+            if (!tp->disabled)
+                continue;
+            data = tp->previous_state;
+            tp->disabled = False;
+        }
+        else {
+            if (tp->previous_state == disable_state ||
+                tp->previous_state == TouchpadOff)
+                continue;
+            data = disable_state;
+            tp->disabled = True;
+        }
+
+        add_pending_write(tp, NextRequest(display));
+        XChangeDeviceProperty(display, tp->dev, touchpad_off_prop,
+                              XA_INTEGER, 8, PropModeReplace, &data, 1);
+        writes++;
     }
-    else
+
+    if (!writes)
         return;
 
-    /* This potentially overwrites a different client's setting, but ... */
-    XChangeDeviceProperty(display, dev, touchpad_off_prop, XA_INTEGER, 8,
-                          PropModeReplace, &data, 1);
+    if (verbose)
+        printf(enable ? "Enable\n" : "Disable\n");
     XFlush(display);
 }
 
@@ -214,41 +517,12 @@ keyboard_activity(Display * display)
 }
 
 static double
-get_time(void)
+get_monotonic_time(void)
 {
-    struct timeval tv;
+    struct timespec ts;
 
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec + tv.tv_usec / 1000000.0;
-}
-
-static void
-main_loop(Display * display, double idle_time, int poll_delay)
-{
-    double last_activity = 0.0;
-    double current_time;
-
-    keyboard_activity(display);
-
-    for (;;) {
-        current_time = get_time();
-        if (keyboard_activity(display))
-            last_activity = current_time;
-
-        /* If system times goes backwards, touchpad can get locked. Make
-         * sure our last activity wasn't in the future and reset if it was. */
-        if (last_activity > current_time)
-            last_activity = current_time - idle_time - 1;
-
-        if (current_time > last_activity + idle_time) { /* Enable touchpad */
-            toggle_touchpad(True);
-        }
-        else {                  /* Disable touchpad */
-            toggle_touchpad(False);
-        }
-
-        usleep(poll_delay);
-    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
 }
 
 static void
@@ -281,6 +555,210 @@ setup_keyboard_mask(Display * display, int ignore_modifier_keys)
     }
 }
 
+/**
+ * Apply -K to a key state bitmap: activity doesn't count while a modifier
+ * is held down.
+ */
+static int
+filter_modifier_combos(int activity, const unsigned char *key_state)
+{
+    int i;
+
+    if (activity && ignore_modifier_combos) {
+        for (i = 0; i < KEYMAP_SIZE; i++)
+            if (key_state[i] & ~keyboard_mask[i])
+                return 0;
+    }
+    return activity;
+}
+
+/* ---- the event loop shared by all keyboard backends ---- */
+
+#define MAX_KEYBOARDS 16
+#define MAX_SOURCES (MAX_KEYBOARDS + 2)
+
+/* Called when fd is readable, returns non-zero on keyboard activity */
+typedef int (*SourceFunc) (int fd, void *data);
+
+struct Source {
+    SourceFunc func;
+    void *data;
+    Display *dpy;               /* Xlib connection behind fd, events already
+                                   in its queue don't show up in poll() */
+};
+
+static struct pollfd source_fds[MAX_SOURCES];
+static struct Source sources[MAX_SOURCES];
+static int num_sources;
+
+/* backends without a file descriptor are called periodically instead */
+static SourceFunc tick_func;
+static double tick_interval;
+
+static Bool
+add_source(int fd, SourceFunc func, void *data, Display * dpy)
+{
+    int i;
+
+    for (i = 0; i < num_sources; i++)
+        if (source_fds[i].fd < 0)
+            break;
+    if (i == MAX_SOURCES)
+        return False;
+    if (i == num_sources)
+        num_sources++;
+
+    source_fds[i].fd = fd;
+    source_fds[i].events = POLLIN;
+    sources[i].func = func;
+    sources[i].data = data;
+    sources[i].dpy = dpy;
+    return True;
+}
+
+/* Stop watching fd, the slot is reused by the next add_source() */
+static void
+remove_source(int fd)
+{
+    int i;
+
+    for (i = 0; i < num_sources; i++)
+        if (source_fds[i].fd == fd)
+            source_fds[i].fd = -1;
+}
+
+/**
+ * Wait for the sources and toggle the touchpad. The loop blocks in poll()
+ * until a source is readable, the next tick is due or, only while the
+ * touchpad is disabled, the monotonic re-enable deadline passes. An idle
+ * keyboard causes no wakeups unless a tick is registered.
+ */
+static void
+event_loop(double idle_time)
+{
+    double deadline = 0.0;
+    double next_tick = 0.0;
+
+    for (;;) {
+        double now = get_monotonic_time();
+        double wakeup = -1.0;
+        int timeout = -1;
+        int activity = 0;
+        int i;
+
+        for (i = 0; i < num_sources; i++)
+            if (source_fds[i].fd >= 0 && sources[i].dpy &&
+                XEventsQueued(sources[i].dpy, QueuedAlready))
+                timeout = 0;
+
+        if (tick_func)
+            wakeup = next_tick;
+        if (pad_disabled && (wakeup < 0.0 || deadline < wakeup))
+            wakeup = deadline;
+        if (timeout && wakeup >= 0.0) {
+            timeout = (wakeup - now) * 1000.0 + 1;
+            if (timeout < 0)
+                timeout = 0;
+        }
+
+        if (poll(source_fds, num_sources, timeout) < 0) {
+            if (errno != EINTR) {
+                perror("poll");
+                exit(4);
+            }
+            continue;
+        }
+
+        for (i = 0; i < num_sources; i++) {
+            int fd = source_fds[i].fd;
+
+            if (fd < 0)
+                continue;
+            if (source_fds[i].revents ||
+                (sources[i].dpy &&
+                 XEventsQueued(sources[i].dpy, QueuedAlready)))
+                activity |= sources[i].func(fd, sources[i].data);
+        }
+
+        now = get_monotonic_time();
+        if (tick_func && now >= next_tick) {
+            activity |= tick_func(-1, NULL);
+            next_tick = now + tick_interval;
+        }
+
+        if (activity) {
+            deadline = now + idle_time;
+            toggle_touchpad(False);
+        }
+        else if (pad_disabled && now >= deadline)
+            toggle_touchpad(True);
+    }
+}
+
+/**
+ * Handle everything queued on the main connection: device notifications
+ * for all backends and, if selected by -X, XInput 2 raw key events.
+ * Returns non-zero if any key event counts as keyboard activity.
+ */
+static int
+display_source(int fd, void *data)
+{
+    unsigned char *key_state = data;
+    int ret = 0;
+
+    while (XPending(display)) {
+        XEvent ev;
+
+        XNextEvent(display, &ev);
+        if (ev.type != GenericEvent) {
+            handle_property_event(&ev);
+            continue;
+        }
+
+#ifdef HAVE_X11_EXTENSIONS_XINPUT2_H
+        {
+            XGenericEventCookie *cookie = &ev.xcookie;
+            XIRawEvent *raw;
+            int kc;
+
+            if (cookie->extension != xi_opcode ||
+                !XGetEventData(display, cookie))
+                continue;
+
+            if (cookie->evtype == XI_HierarchyChanged) {
+                handle_hierarchy_event(cookie->data);
+                XFreeEventData(display, cookie);
+                continue;
+            }
+
+            raw = cookie->data;
+            kc = raw->detail;
+            if (kc >= 0 && kc < KEYMAP_SIZE * 8) {
+                if (cookie->evtype == XI_RawKeyPress) {
+                    if (!(key_state[kc / 8] & (1 << (kc % 8))) &&
+                        (keyboard_mask[kc / 8] & (1 << (kc % 8))))
+                        ret = 1;
+                    key_state[kc / 8] |= 1 << (kc % 8);
+                }
+                else
+                    key_state[kc / 8] &= ~(1 << (kc % 8));
+            }
+
+            XFreeEventData(display, cookie);
+        }
+#endif                          /* HAVE_X11_EXTENSIONS_XINPUT2_H */
+    }
+
+    return filter_modifier_combos(ret, key_state);
+}
+
+/* The original backend: compare the keymap every tick */
+static int
+keymap_tick(int fd, void *data)
+{
+    return keyboard_activity(display);
+}
+
 /* ---- the following code is for using the xrecord extension ----- */
 #ifdef HAVE_X11_EXTENSIONS_RECORD_H
 
@@ -292,6 +770,7 @@ struct xrecord_callback_results {
     Bool key_event;
     Bool non_modifier_event;
     KeyCode pressed_modifiers[MAX_MODIFIERS];
+    Display *dpy_data;
 };
 
 /* test if the xrecord extension is found */
@@ -390,164 +869,197 @@ is_modifier_pressed(const struct xrecord_callback_results *cbres)
     return 0;
 }
 
-void
-record_main_loop(Display * display, double idle_time)
+/* Process the recorded key events on the data connection */
+static int
+record_source(int fd, void *data)
 {
+    struct xrecord_callback_results *cbres = data;
+    int disable_event = 0;
+
+    cbres->key_event = 0;
+    cbres->non_modifier_event = 0;
+
+    XRecordProcessReplies(cbres->dpy_data);
+
+    /* If there are any events left over, they are in error. Drain them
+     * from the connection queue so we don't get stuck. */
+    while (XEventsQueued(cbres->dpy_data, QueuedAlready) > 0) {
+        XEvent event;
+
+        XNextEvent(cbres->dpy_data, &event);
+        fprintf(stderr, "bad event received, major opcode %d\n", event.type);
+    }
+
+    if (!ignore_modifier_keys && cbres->key_event) {
+        disable_event = 1;
+    }
+
+    if (cbres->non_modifier_event &&
+        !(ignore_modifier_combos && is_modifier_pressed(cbres))) {
+        disable_event = 1;
+    }
+
+    return disable_event;
+}
 
-    struct xrecord_callback_results cbres;
+/* Record key events of all clients on an additional data connection */
+static Bool
+record_init(Display * display)
+{
+    static struct xrecord_callback_results cbres;
     XRecordContext context;
     XRecordClientSpec cspec = XRecordAllClients;
-    Display *dpy_data;
     XRecordRange *range;
-    int i;
 
-    dpy_data = XOpenDisplay(NULL);      /* we need an additional data connection. */
-    range = XRecordAllocRange();
+    cbres.dpy_data = XOpenDisplay(NULL);
+    if (!cbres.dpy_data)
+        return False;
 
+    range = XRecordAllocRange();
     range->device_events.first = KeyPress;
     range->device_events.last = KeyRelease;
 
-    context = XRecordCreateContext(dpy_data, 0, &cspec, 1, &range, 1);
+    context = XRecordCreateContext(cbres.dpy_data, 0, &cspec, 1, &range, 1);
+    XFree(range);
 
-    XRecordEnableContextAsync(dpy_data, context, xrecord_callback,
+    XRecordEnableContextAsync(cbres.dpy_data, context, xrecord_callback,
                               (XPointer) & cbres);
 
     cbres.modifiers = XGetModifierMapping(display);
     /* clear list of modifiers */
-    for (i = 0; i < MAX_MODIFIERS; ++i)
-        cbres.pressed_modifiers[i] = 0;
-
-    while (1) {
+    memset(cbres.pressed_modifiers, 0, sizeof(cbres.pressed_modifiers));
 
-        int fd = ConnectionNumber(dpy_data);
-        fd_set read_fds;
-        int ret;
-        int disable_event = 0;
-        struct timeval timeout;
+    return add_source(ConnectionNumber(cbres.dpy_data), record_source,
+                      &cbres, cbres.dpy_data);
+}
+#endif                          /* HAVE_X11_EXTENSIONS_RECORD_H */
 
-        FD_ZERO(&read_fds);
-        FD_SET(fd, &read_fds);
+/* ---- the following code is for reading the keyboard event devices ---- */
 
-        ret = select(fd + 1 /* =(max descriptor in read_fds) + 1 */ ,
-                     &read_fds, NULL, NULL,
-                     pad_disabled ? &timeout : NULL
-                     /* timeout only required for enabling */ );
+#define DEV_INPUT_DIR "/dev/input"
 
-        if (FD_ISSET(fd, &read_fds)) {
+#define NBITS(x) ((((x) - 1) / (sizeof(long) * 8)) + 1)
+#define TEST_BIT(bit, array) \
+    ((array[(bit) / (sizeof(long) * 8)] >> ((bit) % (sizeof(long) * 8))) & 1)
 
-            cbres.key_event = 0;
-            cbres.non_modifier_event = 0;
+/* X keycodes are evdev keycodes + 8 */
+#define EVDEV_XKB_OFFSET 8
 
-            XRecordProcessReplies(dpy_data);
+/**
+ * Return True if the device behind fd looks like a keyboard, i.e. it has
+ * letter keys and isn't a pointing device with a few buttons.
+ */
+static Bool
+evdev_is_keyboard(int fd)
+{
+    unsigned long evbits[NBITS(EV_MAX + 1)] = { 0 };
+    unsigned long keybits[NBITS(KEY_MAX + 1)] = { 0 };
 
-            /* If there are any events left over, they are in error. Drain them
-             * from the connection queue so we don't get stuck. */
-            while (XEventsQueued(dpy_data, QueuedAlready) > 0) {
-                XEvent event;
+    if (ioctl(fd, EVIOCGBIT(0, sizeof(evbits)), evbits) < 0 ||
+        !TEST_BIT(EV_KEY, evbits))
+        return False;
 
-                XNextEvent(dpy_data, &event);
-                fprintf(stderr, "bad event received, major opcode %d\n",
-                        event.type);
-            }
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keybits)), keybits) < 0)
+        return False;
 
-            if (!ignore_modifier_keys && cbres.key_event) {
-                disable_event = 1;
-            }
+    return TEST_BIT(KEY_A, keybits) && TEST_BIT(KEY_Z, keybits) &&
+        TEST_BIT(KEY_SPACE, keybits) && !TEST_BIT(BTN_TOUCH, keybits);
+}
 
-            if (cbres.non_modifier_event &&
-                !(ignore_modifier_combos && is_modifier_pressed(&cbres))) {
-                disable_event = 1;
-            }
-        }
+/**
+ * Read all pending events from a keyboard. Return non-zero if any of them
+ * counts as keyboard activity, with the same rules keyboard_activity()
+ * applies to the keymap. All keyboards share one key state.
+ */
+static int
+evdev_source(int fd, void *data)
+{
+    unsigned char *key_state = data;
+    struct input_event ev[64];
+    int ret = 0;
+    int i, n;
 
-        if (disable_event) {
-            /* adjust the enable_time */
-            timeout.tv_sec = (int) idle_time;
-            timeout.tv_usec = (idle_time - (double) timeout.tv_sec) * 1.e6;
+    while ((n = read(fd, ev, sizeof(ev))) > 0) {
+        for (i = 0; i < n / sizeof(ev[0]); i++) {
+            int kc = ev[i].code + EVDEV_XKB_OFFSET;
 
-            toggle_touchpad(False);
-        }
+            if (ev[i].type != EV_KEY || kc >= KEYMAP_SIZE * 8)
+                continue;
 
-        if (ret == 0 && pad_disabled) { /* timeout => enable event */
-            toggle_touchpad(True);
+            if (ev[i].value == 1) {
+                if (keyboard_mask[kc / 8] & (1 << (kc % 8)))
+                    ret = 1;
+                key_state[kc / 8] |= 1 << (kc % 8);
+            }
+            else if (ev[i].value == 0)
+                key_state[kc / 8] &= ~(1 << (kc % 8));
         }
+    }
 
-    }                           /* end while(1) */
+    if (n < 0 && errno == ENODEV) {
+        /* keyboard unplugged */
+        remove_source(fd);
+        close(fd);
+    }
 
-    XFreeModifiermap(cbres.modifiers);
+    return filter_modifier_combos(ret, key_state);
 }
-#endif                          /* HAVE_X11_EXTENSIONS_RECORD_H */
 
-static XDevice *
-dp_get_device(Display * dpy)
+/* Open all keyboards read-only, without grabbing them, and add them as
+ * sources. Returns the number of keyboards found. */
+static int
+evdev_open_keyboards(void)
 {
-    XDevice *dev = NULL;
-    XDeviceInfo *info = NULL;
-    int ndevices = 0;
-    Atom touchpad_type = 0;
-    Atom *properties = NULL;
-    int nprops = 0;
-    int error = 0;
-
-    touchpad_type = XInternAtom(dpy, XI_TOUCHPAD, True);
-    touchpad_off_prop = XInternAtom(dpy, SYNAPTICS_PROP_OFF, True);
-    info = XListInputDevices(dpy, &ndevices);
-
-    while (ndevices--) {
-        if (info[ndevices].type == touchpad_type) {
-            dev = XOpenDevice(dpy, info[ndevices].id);
-            if (!dev) {
-                fprintf(stderr, "Failed to open device '%s'.\n",
-                        info[ndevices].name);
-                error = 1;
-                goto unwind;
-            }
-
-            properties = XListDeviceProperties(dpy, dev, &nprops);
-            if (!properties || !nprops) {
-                fprintf(stderr, "No properties on device '%s'.\n",
-                        info[ndevices].name);
-                error = 1;
-                goto unwind;
-            }
-
-            while (nprops--) {
-                if (properties[nprops] == touchpad_off_prop)
-                    break;
-            }
-            if (nprops < 0) {
-                fprintf(stderr, "No synaptics properties on device '%s'.\n",
-                        info[ndevices].name);
-                error = 1;
-                goto unwind;
-            }
-
-            break;              /* Yay, device is suitable */
+    static unsigned char key_state[KEYMAP_SIZE];
+    DIR *dir;
+    struct dirent *entry;
+    int nkbd = 0;
+
+    dir = opendir(DEV_INPUT_DIR);
+    if (!dir)
+        return 0;
+
+    while ((entry = readdir(dir)) && nkbd < MAX_KEYBOARDS) {
+        char path[PATH_MAX];
+        int fd;
+
+        if (strncmp(entry->d_name, "event", 5) != 0)
+            continue;
+
+        snprintf(path, sizeof(path), "%s/%s", DEV_INPUT_DIR, entry->d_name);
+        fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        if (!evdev_is_keyboard(fd) ||
+            !add_source(fd, evdev_source, key_state, NULL)) {
+            close(fd);
+            continue;
         }
-    }
 
- unwind:
-    XFree(properties);
-    XFreeDeviceList(info);
-    if (!dev)
-        fprintf(stderr, "Unable to find a synaptics device.\n");
-    else if (error && dev) {
-        XCloseDevice(dpy, dev);
-        dev = NULL;
+        if (verbose)
+            printf("Monitoring keyboard %s\n", path);
+        nkbd++;
     }
-    return dev;
+
+    closedir(dir);
+    return nkbd;
 }
 
 int
 main(int argc, char *argv[])
 {
+    static unsigned char xi2_key_state[KEYMAP_SIZE];
     double idle_time = 2.0;
     int poll_delay = 200000;    /* 200 ms */
     int c;
     int use_xrecord = 0;
+    int use_xi2 = 0;
+    int use_evdev = 0;
+    int xi_event;
 
     /* Parse command line parameters */
-    while ((c = getopt(argc, argv, "i:m:dtp:kKR?v")) != EOF) {
+    while ((c = getopt(argc, argv, "i:m:dtp:kKRXE?v")) != EOF) {
         switch (c) {
         case 'i':
             idle_time = atof(optarg);
@@ -574,6 +1086,12 @@ main(int argc, char *argv[])
         case 'R':
             use_xrecord = 1;
             break;
+        case 'X':
+            use_xi2 = 1;
+            break;
+        case 'E':
+            use_evdev = 1;
+            break;
         case 'v':
             verbose = 1;
             break;
@@ -593,8 +1111,22 @@ main(int argc, char *argv[])
         exit(2);
     }
 
-    if (!(dev = dp_get_device(display)))
+    if (!XQueryExtension(display, "XInputExtension", &xi_opcode,
+                         &xi_event, &xi_error_base))
+        xi_opcode = 0;
+    default_error_handler = XSetErrorHandler(error_handler);
+
+    touchpad_off_prop = XInternAtom(display, SYNAPTICS_PROP_OFF, True);
+    if (!touchpad_off_prop || !scan_touchpads()) {
+        fprintf(stderr, "Unable to find a synaptics device.\n");
         exit(2);
+    }
+
+#ifdef HAVE_X11_EXTENSIONS_XINPUT2_H
+    /* pick up touchpads added later, e.g. after resume or docking */
+    if (check_xi2(display))
+        select_xi2_events(False);
+#endif                          /* HAVE_X11_EXTENSIONS_XINPUT2_H */
 
     /* Install a signal handler to restore synaptics parameters on exit */
     install_signal_handler();
@@ -626,13 +1158,39 @@ main(int argc, char *argv[])
     }
 
     pad_disabled = False;
-    store_current_touchpad_state();
 
+    /* device notifications, and raw key events if -X selects them */
+    add_source(ConnectionNumber(display), display_source, xi2_key_state,
+               display);
+
+    if (use_evdev) {
+        setup_keyboard_mask(display, ignore_modifier_keys);
+        if (!evdev_open_keyboards()) {
+            fprintf(stderr, "No readable keyboard found in %s.\n",
+                    DEV_INPUT_DIR);
+            exit(4);
+        }
+    }
+    else
+#ifdef HAVE_X11_EXTENSIONS_XINPUT2_H
+    if (use_xi2) {
+        if (check_xi2(display)) {
+            setup_keyboard_mask(display, ignore_modifier_keys);
+            /* raw events are delivered for slave and master devices
+             * alike, the key state bitmap makes the duplicates harmless */
+            select_xi2_events(True);
+        }
+        else {
+            fprintf(stderr, "Use of XInput 2 requested, but failed to "
+                    "initialize.\n");
+            exit(4);
+        }
+    }
+    else
+#endif                          /* HAVE_X11_EXTENSIONS_XINPUT2_H */
 #ifdef HAVE_X11_EXTENSIONS_RECORD_H
     if (use_xrecord) {
-        if (check_xrecord(display))
-            record_main_loop(display, idle_time);
-        else {
+        if (!check_xrecord(display) || !record_init(display)) {
             fprintf(stderr, "Use of XRecord requested, but failed to "
                     " initialize.\n");
             exit(4);
@@ -642,10 +1200,14 @@ main(int argc, char *argv[])
 #endif                          /* HAVE_X11_EXTENSIONS_RECORD_H */
     {
         setup_keyboard_mask(display, ignore_modifier_keys);
-
-        /* Run the main loop */
-        main_loop(display, idle_time, poll_delay);
+        keyboard_activity(display);
+        tick_func = keymap_tick;
+        tick_interval = poll_delay / 1000000.0;
     }
+
+    /* Run the main loop */
+    event_loop(idle_time);
+
     return 0;
 }
 
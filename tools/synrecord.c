@@ -0,0 +1,441 @@
+/*
+ * Copyright © 2014 Sergey Mosin
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the authors
+ * not be used in advertising or publicity pertaining to distribution
+ * of the software without specific, written prior permission.  The
+ * authors make no representations about the suitability of this software
+ * for any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS, IN
+ * NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY SPECIAL, INDIRECT OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS
+ * OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * synrecord: record the event stream of a touchpad into a file the
+ * driver's "replay" protocol can play back. The device is only read, never
+ * grabbed, so the X session keeps working normally while recording.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <time.h>
+#include <linux/input.h>
+#include <libevdev/libevdev.h>
+
+#include "synaptics-record.h"
+#include "evframe.h"
+
+#define DEV_INPUT_EVENT "/dev/input"
+#define EVENT_DEV_NAME "event"
+
+static volatile sig_atomic_t stop;
+static int keep_all;
+static int verbose;
+
+static unsigned long num_events;
+static unsigned long num_frames;
+static unsigned long num_dropped;
+static unsigned long num_bytes;
+
+/* time of the last time record, see synaptics-record.h */
+static struct timeval last_time;
+static int have_time;
+
+static void
+usage(void)
+{
+    fprintf(stderr, "Usage: synrecord [-d device] [-a] [-v] file\n");
+    fprintf(stderr, "  -d Event device to record, default is the first touchpad found.\n");
+    fprintf(stderr, "  -a Keep all events, not only the ones the driver uses.\n");
+    fprintf(stderr, "  -v Print the device and event counts to stderr.\n");
+    fprintf(stderr, "  -? Show this help message.\n");
+    fprintf(stderr, "  file is the recording to write, - writes to stdout.\n");
+    exit(1);
+}
+
+static void
+signal_handler(int signum)
+{
+    stop = 1;
+}
+
+static int
+event_dev_only(const struct dirent *dir)
+{
+    return strncmp(EVENT_DEV_NAME, dir->d_name, 5) == 0;
+}
+
+/**
+ * Open the device and check it's a touchpad. Doesn't grab it, unlike the
+ * driver's probe, the point is to record what the X session sees.
+ */
+static struct libevdev *
+open_touchpad(const char *path, int quiet)
+{
+    struct libevdev *evdev;
+    int fd;
+
+    fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        if (!quiet)
+            fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    if (libevdev_new_from_fd(fd, &evdev) < 0) {
+        if (!quiet)
+            fprintf(stderr, "%s is not an event device\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    if (!EvdevIsTouchpad(evdev)) {
+        if (!quiet)
+            fprintf(stderr, "%s is not a touchpad\n", path);
+        libevdev_free(evdev);
+        close(fd);
+        return NULL;
+    }
+
+    return evdev;
+}
+
+static struct libevdev *
+probe_touchpad(void)
+{
+    struct dirent **namelist;
+    struct libevdev *evdev = NULL;
+    int i, n;
+
+    n = scandir(DEV_INPUT_EVENT, &namelist, event_dev_only, alphasort);
+    if (n < 0) {
+        fprintf(stderr, "Can't open %s: %s\n", DEV_INPUT_EVENT,
+                strerror(errno));
+        return NULL;
+    }
+
+    for (i = 0; i < n; i++) {
+        char path[64];
+
+        if (!evdev) {
+            snprintf(path, sizeof(path), "%s/%s", DEV_INPUT_EVENT,
+                     namelist[i]->d_name);
+            evdev = open_touchpad(path, 1);
+            if (evdev && verbose)
+                fprintf(stderr, "Recording %s\n", path);
+        }
+        free(namelist[i]);
+    }
+    free(namelist);
+
+    if (!evdev)
+        fprintf(stderr, "No readable touchpad found in %s.\n",
+                DEV_INPUT_EVENT);
+
+    return evdev;
+}
+
+static void
+fill_header(struct libevdev *evdev, struct SynapticsRecordHeader *header)
+{
+    int code, slots;
+
+    memset(header, 0, sizeof(*header));
+    header->magic = SYNAPTICS_RECORD_MAGIC;
+    header->version = SYNAPTICS_RECORD_VERSION;
+    header->header_size = sizeof(*header);
+    header->event_size = sizeof(struct SynapticsRecordEvent);
+
+    header->bustype = libevdev_get_id_bustype(evdev);
+    header->vendor = libevdev_get_id_vendor(evdev);
+    header->product = libevdev_get_id_product(evdev);
+    header->id_version = libevdev_get_id_version(evdev);
+    strncpy(header->name, libevdev_get_name(evdev), sizeof(header->name) - 1);
+
+    for (code = 0; code < 32; code++)
+        if (libevdev_has_property(evdev, code))
+            header->props |= 1U << code;
+
+    slots = libevdev_get_num_slots(evdev);
+    header->num_slots = slots > 0 ? slots : 0;
+
+    for (code = 0; code < SYNAPTICS_RECORD_ABS_CNT; code++) {
+        const struct input_absinfo *abs;
+
+        if (!libevdev_has_event_code(evdev, EV_ABS, code))
+            continue;
+
+        abs = libevdev_get_abs_info(evdev, code);
+        header->abs_bits[code / 8] |= 1 << (code % 8);
+        header->abs[code].minimum = abs->minimum;
+        header->abs[code].maximum = abs->maximum;
+        header->abs[code].fuzz = abs->fuzz;
+        header->abs[code].flat = abs->flat;
+        header->abs[code].resolution = abs->resolution;
+    }
+
+    for (code = 0; code < SYNAPTICS_RECORD_KEY_CNT; code++)
+        if (libevdev_has_event_code(evdev, EV_KEY, code))
+            header->key_bits[code / 8] |= 1 << (code % 8);
+}
+
+/**
+ * The driver only looks at the touch slots, the buttons, SYN_REPORT and
+ * SYN_DROPPED (the read loop writes that one). The legacy single touch
+ * axes, tool bits and MSC_TIMESTAMP are about half the events of a
+ * touchpad, leaving them out keeps long recordings small. -a keeps
+ * everything.
+ */
+static int
+want_event(const struct input_event *ev)
+{
+    if (keep_all)
+        return 1;
+
+    switch (ev->type) {
+    case EV_SYN:
+        return ev->code == SYN_REPORT;
+    case EV_KEY:
+        return ev->code >= BTN_MOUSE && ev->code < BTN_JOYSTICK;
+    case EV_ABS:
+        return ev->code >= ABS_MT_SLOT;
+    default:
+        return 0;
+    }
+}
+
+static int
+write_record(FILE *out, int type, int code, int value)
+{
+    struct SynapticsRecordEvent rec;
+
+    rec.type = type;
+    rec.code = code;
+    rec.value = value;
+    num_bytes += sizeof(rec);
+
+    return fwrite(&rec, sizeof(rec), 1, out) == 1;
+}
+
+/**
+ * Write an event, preceded by a time record if its time differs from the
+ * last one, i.e. at the start of a frame.
+ */
+static int
+write_event(FILE *out, struct timeval *tv, int type, int code, int value)
+{
+    if (!have_time || tv->tv_sec != last_time.tv_sec ||
+        tv->tv_usec != last_time.tv_usec) {
+        uint32_t millis = tv->tv_sec * 1000U + tv->tv_usec / 1000;
+
+        if (!write_record(out, SYNAPTICS_RECORD_TIME, tv->tv_usec % 1000,
+                          (int32_t) millis))
+            return 0;
+        last_time = *tv;
+        have_time = 1;
+    }
+
+    if (type == EV_SYN && code == SYN_REPORT)
+        num_frames++;
+    num_events++;
+
+    return write_record(out, type, code, value);
+}
+
+/**
+ * Write the state the device is in when recording starts as one frame, so
+ * a touch or button already down when the recording starts is replayed
+ * too.
+ */
+static int
+write_initial_state(FILE *out, struct libevdev *evdev)
+{
+    struct timespec ts;
+    struct timeval tv;
+    int slot, code;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    tv.tv_sec = ts.tv_sec;
+    tv.tv_usec = ts.tv_nsec / 1000;
+
+    for (slot = 0; slot < libevdev_get_num_slots(evdev); slot++) {
+        int id;
+
+        if (!libevdev_fetch_slot_value(evdev, slot, ABS_MT_TRACKING_ID, &id) ||
+            id < 0)
+            continue;
+
+        if (!write_event(out, &tv, EV_ABS, ABS_MT_SLOT, slot) ||
+            !write_event(out, &tv, EV_ABS, ABS_MT_TRACKING_ID, id))
+            return 0;
+
+        for (code = ABS_MT_SLOT + 1; code < SYNAPTICS_RECORD_ABS_CNT; code++) {
+            int value;
+
+            if (code == ABS_MT_TRACKING_ID ||
+                !libevdev_fetch_slot_value(evdev, slot, code, &value))
+                continue;
+            if (!write_event(out, &tv, EV_ABS, code, value))
+                return 0;
+        }
+    }
+
+    if (libevdev_get_num_slots(evdev) > 0 &&
+        !write_event(out, &tv, EV_ABS, ABS_MT_SLOT,
+                     libevdev_get_current_slot(evdev)))
+        return 0;
+
+    for (code = BTN_MOUSE; code < BTN_JOYSTICK; code++)
+        if (libevdev_get_event_value(evdev, EV_KEY, code) &&
+            !write_event(out, &tv, EV_KEY, code, 1))
+            return 0;
+
+    return write_event(out, &tv, EV_SYN, SYN_REPORT, 0);
+}
+
+static int
+record(struct libevdev *evdev, FILE *out)
+{
+    struct pollfd pfd;
+    unsigned int flag = LIBEVDEV_READ_FLAG_NORMAL;
+
+    pfd.fd = libevdev_get_fd(evdev);
+    pfd.events = POLLIN;
+
+    if (!write_initial_state(out, evdev))
+        return 0;
+
+    while (!stop) {
+        struct input_event ev;
+        int rc;
+
+        rc = libevdev_next_event(evdev, flag, &ev);
+        if (rc == -EAGAIN) {
+            if (flag == LIBEVDEV_READ_FLAG_SYNC) {
+                flag = LIBEVDEV_READ_FLAG_NORMAL;
+                continue;
+            }
+            /* a signal interrupts poll and ends the loop, the timeout
+               covers one arriving just before we get here */
+            if (poll(&pfd, 1, 1000) == -1 && errno != EINTR)
+                return 0;
+            continue;
+        } else if (rc < 0) {
+            fprintf(stderr, "Read error: %s\n", strerror(-rc));
+            return 0;
+        }
+
+        /* SYN_DROPPED, libevdev hands us the events that bring the state
+           back in sync, they're recorded like any other. The SYN_DROPPED
+           itself is kept so a replay drops the frame the same way. */
+        if (rc == LIBEVDEV_READ_STATUS_SYNC &&
+            flag == LIBEVDEV_READ_FLAG_NORMAL) {
+            flag = LIBEVDEV_READ_FLAG_SYNC;
+            num_dropped++;
+            if (!write_event(out, &ev.time, EV_SYN, SYN_DROPPED, 0))
+                return 0;
+            continue;
+        }
+
+        if (want_event(&ev) &&
+            !write_event(out, &ev.time, ev.type, ev.code, ev.value))
+            return 0;
+    }
+
+    return 1;
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct SynapticsRecordHeader header;
+    struct sigaction act;
+    struct libevdev *evdev;
+    const char *device = NULL;
+    FILE *out;
+    int c, ok;
+
+    while ((c = getopt(argc, argv, "d:av?")) != EOF) {
+        switch (c) {
+        case 'd':
+            device = optarg;
+            break;
+        case 'a':
+            keep_all = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            usage();
+            break;
+        }
+    }
+    if (optind != argc - 1)
+        usage();
+
+    evdev = device ? open_touchpad(device, 0) : probe_touchpad();
+    if (!evdev)
+        exit(2);
+
+    if (libevdev_set_clock_id(evdev, CLOCK_MONOTONIC) < 0)
+        fprintf(stderr, "Can't switch to the monotonic clock, "
+                "timestamps may jump.\n");
+
+    if (!strcmp(argv[optind], "-"))
+        out = stdout;
+    else if (!(out = fopen(argv[optind], "wb"))) {
+        fprintf(stderr, "Can't create %s: %s\n", argv[optind],
+                strerror(errno));
+        exit(2);
+    }
+
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = signal_handler;
+    sigaction(SIGINT, &act, NULL);
+    sigaction(SIGTERM, &act, NULL);
+    sigaction(SIGHUP, &act, NULL);
+
+    fill_header(evdev, &header);
+    if (verbose)
+        fprintf(stderr, "Device \"%s\", vendor %#x product %#x, %u slots\n",
+               header.name, header.vendor, header.product, header.num_slots);
+
+    ok = fwrite(&header, sizeof(header), 1, out) == 1 && record(evdev, out);
+    if (fclose(out) != 0)
+        ok = 0;
+    if (!ok)
+        fprintf(stderr, "Writing the recording failed: %s\n", strerror(errno));
+
+    if (verbose)
+        fprintf(stderr, "%lu events, %lu frames, %lu times out of sync, "
+                "%lu bytes\n", num_events, num_frames, num_dropped,
+                num_bytes + sizeof(header));
+
+    close(libevdev_get_fd(evdev));
+    libevdev_free(evdev);
+
+    return ok ? 0 : 3;
+}